@@ -0,0 +1,138 @@
+/*
+ * bench_rtos.c
+ *
+ * Host microbenchmark of the RTOS scheduler. Built once per queue size
+ * by the Makefile, prints one table row per build.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "config.h"
+#include "rtos.h"
+
+#define BENCH_ROUNDS			200000UL
+
+/************************************************************************/
+/* VARS                                                                 */
+/************************************************************************/
+static	volatile	uint32_t	task_runs;
+
+#define TASKS_COUNT				64
+
+//-> Distinct dummy tasks, RTOS queues may reject duplicates
+#define TASK(n)					static void task##n(void) { task_runs++; }
+#define TASK8(n)				TASK(n##0) TASK(n##1) TASK(n##2) TASK(n##3) TASK(n##4) TASK(n##5) TASK(n##6) TASK(n##7)
+#define TASK8_PTR(n)			task##n##0, task##n##1, task##n##2, task##n##3, task##n##4, task##n##5, task##n##6, task##n##7
+TASK8(1) TASK8(2) TASK8(3) TASK8(4) TASK8(5) TASK8(6) TASK8(7) TASK8(8)
+static	const	TPTR		tasks[TASKS_COUNT] = { TASK8_PTR(1), TASK8_PTR(2), TASK8_PTR(3), TASK8_PTR(4),
+										TASK8_PTR(5), TASK8_PTR(6), TASK8_PTR(7), TASK8_PTR(8) };
+
+#if (RTOS_TASK_QUEUE_SIZE > TASKS_COUNT || RTOS_TIMER_TASK_QUEUE_SIZE > TASKS_COUNT)
+	#error "Queue size is larger than dummy tasks count"
+#endif
+
+#if (RTOS_WDT_ENABLE)
+//-> No supervised tasks, dispatch still pays for the deadline lookup
+const	struct		RTOS_DEADLINE_STRUCT	RTOS_Deadlines[RTOS_DEADLINES_COUNT];
+#endif
+
+//-> Accumulated time and operations count of every benchmark
+struct BENCH_STRUCT
+{
+	uint64_t		ns;
+	uint64_t		ops;
+};
+
+static	struct		BENCH_STRUCT	b_set_task, b_set_timer_new, b_set_timer_upd,
+									b_manager_run, b_manager_idle, b_service_wait, b_service_fire;
+static	uint64_t	clock_overhead;
+
+
+/************************************************************************/
+/* FUNCTIONS                                                            */
+/************************************************************************/
+static inline uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void bench_add(struct BENCH_STRUCT *b, uint64_t start, uint32_t ops)
+{
+	uint64_t t = now_ns() - start;
+	b->ns += (t > clock_overhead) ? t - clock_overhead : 0;
+	b->ops += ops;
+}
+
+static double bench_ns(const struct BENCH_STRUCT *b)
+{
+	return b->ops ? (double)b->ns / b->ops : 0.0;
+}
+
+//------------------------------ Cost of one now_ns() pair, subtracted from each batch
+static void calibrate(void)
+{
+	uint64_t best = ~0ULL;
+	for(uint32_t r = 0; r < 100000; r++) {
+		uint64_t s = now_ns();
+		uint64_t t = now_ns() - s;
+		if(t < best) best = t;
+	}
+	clock_overhead = best;
+}
+
+int main(void)
+{
+	uint64_t s;
+	uint8_t i;
+
+	calibrate();
+	sei();
+	RTOS_Init();
+
+	for(uint32_t r = 0; r < BENCH_ROUNDS; r++) {
+		// Fill task queue
+		s = now_ns();
+		for(i = 0; i < RTOS_TASK_QUEUE_SIZE; i++) RTOS_SetTask(tasks[i]);
+		bench_add(&b_set_task, s, RTOS_TASK_QUEUE_SIZE);
+		// Drain task queue
+		s = now_ns();
+		for(i = 0; i < RTOS_TASK_QUEUE_SIZE; i++) RTOS_TaskManager();
+		bench_add(&b_manager_run, s, RTOS_TASK_QUEUE_SIZE);
+		// Empty queue dispatch
+		s = now_ns();
+		for(i = 0; i < RTOS_TASK_QUEUE_SIZE; i++) RTOS_TaskManager();
+		bench_add(&b_manager_idle, s, RTOS_TASK_QUEUE_SIZE);
+
+		// Fill timer queue with new tasks
+		s = now_ns();
+		for(i = 0; i < RTOS_TIMER_TASK_QUEUE_SIZE; i++) RTOS_SetTimerTask(tasks[i], 2);
+		bench_add(&b_set_timer_new, s, RTOS_TIMER_TASK_QUEUE_SIZE);
+		// Re-arm tasks which are already in timer queue
+		s = now_ns();
+		for(i = 0; i < RTOS_TIMER_TASK_QUEUE_SIZE; i++) RTOS_SetTimerTask(tasks[i], 1);
+		bench_add(&b_set_timer_upd, s, RTOS_TIMER_TASK_QUEUE_SIZE);
+		// Systick with nothing expired
+		s = now_ns();
+		RTOS_TimerService();
+		bench_add(&b_service_wait, s, 1);
+		// Systick with all tasks expired, moves them into task queue
+		s = now_ns();
+		RTOS_TimerService();
+		bench_add(&b_service_fire, s, 1);
+		// Flush expired tasks
+		for(i = 0; i < RTOS_TASK_QUEUE_SIZE; i++) RTOS_TaskManager();
+	}
+
+	// One row: queue sizes and ns per operation
+	printf("| %5u | %5u | %8.1f | %8.1f | %8.1f | %8.1f | %8.1f | %8.1f | %8.1f |\n",
+		RTOS_TASK_QUEUE_SIZE, RTOS_TIMER_TASK_QUEUE_SIZE,
+		bench_ns(&b_set_task), bench_ns(&b_set_timer_new), bench_ns(&b_set_timer_upd),
+		bench_ns(&b_manager_run), bench_ns(&b_manager_idle),
+		bench_ns(&b_service_wait), bench_ns(&b_service_fire));
+	return 0;
+}
@@ -0,0 +1,332 @@
+/*
+ * sim_cycles.c
+ *
+ * Cycle budget harness. Boots the real firmware image in simavr, plays
+ * a short input script (enter setup, dial a few seconds, start the
+ * countdown and wait for the alarm) and measures cycles per call of
+ * the functions listed in budgets.txt. Fails when a function or the
+ * whole image is over its budget, or was called fewer times than its
+ * budget line asks, which catches a script out of step with the UI.
+ * Option -p plays the extra press of program setup (PROG_ENABLE image).
+ *
+ * Free RAM above .bss is painted with the stack canary before boot and
+ * scanned after the run, the untouched bytes are the stack high-water
+ * mark. Optional "stack N" line in budgets.txt is the minimum allowed.
+ *
+ * Symbols inlined by LTO have no address and are reported as skipped,
+ * 'make cycles' builds the image without LTO to get every hot path.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <elf.h>
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/avr_ioport.h>
+
+#define F_CPU					8000000UL
+#define MS_TO_CYCLES(ms)		((avr_cycle_count_t)(ms) * (F_CPU / 1000UL))
+#define FUNCS_MAX				16
+#define NAME_MAX_LEN			32
+#define STACK_CANARY			0xC5				// Same as DIAG_STACK_CANARY
+#define DATA_SPACE_OFFSET		0x800000UL			// avr-gcc address of SRAM byte 0
+
+/************************************************************************/
+/* VARS                                                                 */
+/************************************************************************/
+struct FUNC_STRUCT
+{
+	char				name[NAME_MAX_LEN];
+	uint8_t				inclusive;			// Count callees and nested ISRs
+	uint32_t			budget_cycles,
+						budget_bytes,
+						min_calls;
+	uint32_t			addr,				// Byte address, 0 if not found
+						size;
+	// Current call
+	uint8_t				active;
+	uint16_t			entry_sp;
+	uint32_t			cycles;
+	// Statistics
+	uint32_t			calls,
+						max_cycles;
+	uint64_t			total_cycles;
+};
+
+static	struct		FUNC_STRUCT		funcs[FUNCS_MAX];
+static	uint8_t		funcs_count;
+static	uint32_t	flash_budget, flash_used;
+static	uint32_t	ram_budget, ram_used;
+static	uint32_t	stack_budget, bss_end;			// bss_end is _end in SRAM, 0 if not found
+
+//-> Input script: time in ms, PIND bits PD2..PD0 (button, encoder B, A)
+struct STEP_STRUCT
+{
+	uint32_t			time_ms;
+	uint8_t				pins,
+						prog;				// Played only with -p
+};
+
+#define BTN_UP				(1<<2)
+#define ENC(s)				(s)
+static const struct STEP_STRUCT script[] = {
+	{    0, BTN_UP | ENC(3) },
+	// Long press: enter seconds setup
+	{  200,          ENC(3) },
+	{ 1000, BTN_UP | ENC(3) },
+	// Three detents clockwise: 3 -> 1 -> 0 -> 2 -> 3
+	{ 1100, BTN_UP | ENC(1) }, { 1105, BTN_UP | ENC(0) }, { 1110, BTN_UP | ENC(2) }, { 1115, BTN_UP | ENC(3) },
+	{ 1200, BTN_UP | ENC(1) }, { 1205, BTN_UP | ENC(0) }, { 1210, BTN_UP | ENC(2) }, { 1215, BTN_UP | ENC(3) },
+	{ 1300, BTN_UP | ENC(1) }, { 1305, BTN_UP | ENC(0) }, { 1310, BTN_UP | ENC(2) }, { 1315, BTN_UP | ENC(3) },
+	// Short presses: minutes, hours, normal or program setup
+	{ 1500,          ENC(3) }, { 1600, BTN_UP | ENC(3) },
+	{ 1800,          ENC(3) }, { 1900, BTN_UP | ENC(3) },
+	{ 2100,          ENC(3) }, { 2200, BTN_UP | ENC(3) },
+	// Short press: program setup to normal
+	{ 2400,          ENC(3), 1 }, { 2500, BTN_UP | ENC(3), 1 },
+	// Short press: start countdown
+	{ 2700,          ENC(3) }, { 2800, BTN_UP | ENC(3) },
+	// Countdown of 3s ends and 5 beeps of alarm play
+	{ 12000, BTN_UP | ENC(3) }
+};
+#define SCRIPT_STEPS		(sizeof(script) / sizeof(script[0]))
+
+
+/************************************************************************/
+/* FUNCTIONS                                                            */
+/************************************************************************/
+//------------------------------ Load budgets.txt
+static int load_budgets(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	char line[128], name[NAME_MAX_LEN], mode[8];
+	uint32_t cycles, bytes, calls = 0;
+	int n;
+
+	if(!f) {
+		perror(path);
+		return -1;
+	}
+	while(fgets(line, sizeof(line), f)) {
+		if(line[0] == '#' || line[0] == '\n') continue;
+		if(sscanf(line, "flash %u", &flash_budget) == 1) continue;
+		if(sscanf(line, "ram %u", &ram_budget) == 1) continue;
+		if(sscanf(line, "stack %u", &stack_budget) == 1) continue;
+		n = sscanf(line, "%31s %7s %u %u %u", name, mode, &cycles, &bytes, &calls);
+		if(n < 4 || funcs_count == FUNCS_MAX) {
+			fprintf(stderr, "%s: bad line: %s", path, line);
+			fclose(f);
+			return -1;
+		}
+		struct FUNC_STRUCT *fn = &funcs[funcs_count++];
+		strcpy(fn->name, name);
+		fn->inclusive = !strcmp(mode, "incl");
+		fn->budget_cycles = cycles;
+		fn->budget_bytes = bytes;
+		fn->min_calls = (n == 5) ? calls : 0;
+		calls = 0;
+	}
+	fclose(f);
+	return 0;
+}
+
+//------------------------------ Read function symbols, end of .bss, flash and RAM usage from ELF32 image
+static int load_symbols(const char *path)
+{
+	FILE *f = fopen(path, "rb");
+	long len;
+	uint8_t *img;
+
+	if(!f) {
+		perror(path);
+		return -1;
+	}
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	img = malloc(len);
+	if(!img || fread(img, 1, len, f) != (size_t)len) {
+		fclose(f);
+		free(img);
+		return -1;
+	}
+	fclose(f);
+
+	Elf32_Ehdr *eh = (Elf32_Ehdr *)img;
+	Elf32_Shdr *sh = (Elf32_Shdr *)(img + eh->e_shoff);
+	const char *shstr = (const char *)(img + sh[eh->e_shstrndx].sh_offset);
+
+	for(int i = 0; i < eh->e_shnum; i++) {
+		const char *sname = shstr + sh[i].sh_name;
+		// Flash image is code plus initial values of .data
+		if(!strcmp(sname, ".text") || !strcmp(sname, ".data")) flash_used += sh[i].sh_size;
+		if(!strcmp(sname, ".data") || !strcmp(sname, ".bss") || !strcmp(sname, ".noinit")) ram_used += sh[i].sh_size;
+		if(sh[i].sh_type != SHT_SYMTAB) continue;
+
+		Elf32_Sym *sym = (Elf32_Sym *)(img + sh[i].sh_offset);
+		const char *str = (const char *)(img + sh[sh[i].sh_link].sh_offset);
+		for(uint32_t n = 0; n < sh[i].sh_size / sizeof(Elf32_Sym); n++) {
+			if(!strcmp(str + sym[n].st_name, "_end")) bss_end = sym[n].st_value - DATA_SPACE_OFFSET;
+			if(ELF32_ST_TYPE(sym[n].st_info) != STT_FUNC) continue;
+			for(int k = 0; k < funcs_count; k++) {
+				if(!strcmp(str + sym[n].st_name, funcs[k].name)) {
+					funcs[k].addr = sym[n].st_value;
+					funcs[k].size = sym[n].st_size;
+				}
+			}
+		}
+	}
+	free(img);
+	return 0;
+}
+
+//------------------------------ Account one executed instruction
+static void account(uint32_t pc, uint16_t sp, uint32_t cycles)
+{
+	for(int k = 0; k < funcs_count; k++) {
+		struct FUNC_STRUCT *fn = &funcs[k];
+		if(!fn->addr) continue;
+
+		// Call entry, return address is already on stack
+		if(!fn->active && pc == fn->addr) {
+			fn->active = 1;
+			fn->entry_sp = sp;
+			fn->cycles = 0;
+		}
+		if(!fn->active) continue;
+
+		if(fn->inclusive || (pc >= fn->addr && pc < fn->addr + fn->size)) {
+			fn->cycles += cycles;
+		}
+	}
+}
+
+//------------------------------ Close calls which returned
+static void account_returns(uint16_t sp)
+{
+	for(int k = 0; k < funcs_count; k++) {
+		struct FUNC_STRUCT *fn = &funcs[k];
+		if(fn->active && sp > fn->entry_sp) {
+			fn->active = 0;
+			fn->calls++;
+			fn->total_cycles += fn->cycles;
+			if(fn->cycles > fn->max_cycles) fn->max_cycles = fn->cycles;
+		}
+	}
+}
+
+//------------------------------ Count canary bytes above .bss untouched by the stack
+static uint32_t stack_free(avr_t *avr)
+{
+	uint32_t p = bss_end;
+
+	while(p <= avr->ramend && avr->data[p] == STACK_CANARY) {
+		p++;
+	}
+	return p - bss_end;
+}
+
+//------------------------------ Drive PD0..PD2 inputs
+static void set_pins(avr_t *avr, uint8_t pins)
+{
+	for(int b = 0; b < 3; b++) {
+		avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), b), (pins >> b) & 1);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	elf_firmware_t fw;
+	avr_t *avr;
+	uint32_t step = 0;
+	int failed = 0, prog = 0;
+
+	if(argc > 1 && !strcmp(argv[1], "-p")) {
+		prog = 1;
+		argv++;
+		argc--;
+	}
+	if(argc < 3) {
+		fprintf(stderr, "usage: %s [-p] firmware.elf budgets.txt\n", argv[0]);
+		return 2;
+	}
+	if(load_budgets(argv[2]) || load_symbols(argv[1])) return 2;
+
+	memset(&fw, 0, sizeof(fw));
+	if(elf_read_firmware(argv[1], &fw)) {
+		fprintf(stderr, "%s: can not load firmware\n", argv[1]);
+		return 2;
+	}
+	avr = avr_make_mcu_by_name(fw.mmcu[0] ? fw.mmcu : "attiny2313a");
+	if(!avr) avr = avr_make_mcu_by_name("attiny2313");
+	if(!avr) {
+		fprintf(stderr, "simavr has no ATtiny2313 core\n");
+		return 2;
+	}
+	avr_init(avr);
+	avr_load_firmware(avr, &fw);
+	avr->frequency = F_CPU;
+	if(!bss_end) {
+		fprintf(stderr, "%s: no _end symbol\n", argv[1]);
+		return 2;
+	}
+	// Paint free RAM, firmware init touches only .data and .bss below _end
+	memset(&avr->data[bss_end], STACK_CANARY, avr->ramend + 1 - bss_end);
+
+	// Run script until last step
+	avr_cycle_count_t end = MS_TO_CYCLES(script[SCRIPT_STEPS - 1].time_ms);
+	while(avr->cycle < end) {
+		if(step < SCRIPT_STEPS && avr->cycle >= MS_TO_CYCLES(script[step].time_ms)) {
+			if(prog || !script[step].prog) set_pins(avr, script[step].pins);
+			step++;
+		}
+		uint32_t pc = avr->pc;
+		uint16_t sp = avr->data[R_SPL] | (avr->data[R_SPH] << 8);
+		avr_cycle_count_t before = avr->cycle;
+
+		int state = avr_run(avr);
+		if(state == cpu_Done || state == cpu_Crashed) {
+			fprintf(stderr, "CPU stopped at PC 0x%04x\n", avr->pc);
+			return 2;
+		}
+		account(pc, sp, avr->cycle - before);
+		account_returns(avr->data[R_SPL] | (avr->data[R_SPH] << 8));
+	}
+
+	// Report
+	printf("%-24s %5s %8s %8s %8s %8s %6s %6s\n", "function", "mode", "calls", "avg", "max", "budget", "bytes", "budget");
+	for(int k = 0; k < funcs_count; k++) {
+		struct FUNC_STRUCT *fn = &funcs[k];
+		const char *verdict = "";
+
+		if(!fn->addr) {
+			printf("%-24s %5s   skipped: no symbol, inlined?\n", fn->name, fn->inclusive ? "incl" : "excl");
+			continue;
+		}
+		if(fn->max_cycles > fn->budget_cycles || fn->size > fn->budget_bytes) {
+			verdict = "  OVER BUDGET";
+			failed = 1;
+		} else if(fn->calls < fn->min_calls) {
+			verdict = "  TOO FEW CALLS";
+			failed = 1;
+		}
+		printf("%-24s %5s %8u %8u %8u %8u %6u %6u%s\n", fn->name, fn->inclusive ? "incl" : "excl", fn->calls,
+			fn->calls ? (uint32_t)(fn->total_cycles / fn->calls) : 0, fn->max_cycles, fn->budget_cycles,
+			fn->size, fn->budget_bytes, verdict);
+	}
+	printf("%-24s %5s %8s %8s %8s %8s %6u %6u%s\n", "flash (.text + .data)", "", "", "", "", "",
+		flash_used, flash_budget, (flash_budget && flash_used > flash_budget) ? "  OVER BUDGET" : "");
+	if(flash_budget && flash_used > flash_budget) failed = 1;
+	printf("%-24s %5s %8s %8s %8s %8s %6u %6u%s\n", "ram (.data+.bss+.noinit)", "", "", "", "", "",
+		ram_used, ram_budget, (ram_budget && ram_used > ram_budget) ? "  OVER BUDGET" : "");
+	if(ram_budget && ram_used > ram_budget) failed = 1;
+
+	uint32_t free_bytes = stack_free(avr);
+	printf("%-24s %5s %8s %8s %8s %8s %6u %6u%s\n", "stack free (canary)", "", "", "", "", "",
+		free_bytes, stack_budget, free_bytes < stack_budget ? "  OVER BUDGET" : "");
+	if(free_bytes < stack_budget) failed = 1;
+
+	return failed;
+}
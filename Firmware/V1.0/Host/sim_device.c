@@ -0,0 +1,791 @@
+/*
+ * sim_device.c
+ *
+ * Virtual SimpleTime unit. The real firmware sources run on the host
+ * against the stub register layer. This file models the peripherals:
+ *  - Timer0/Timer1 counters, compare matches and interrupt dispatch,
+ *    driven by a virtual CPU clock that moves only in busy-waits and
+ *    while the RTOS is idle;
+ *  - HD44780 controller decoding the 4-bit bus into a 16x2 screen,
+ *    including the busy time that makes it ignore early strobes;
+ *  - scripted encoder quadrature on PD0/PD1 and button on PD2.
+ * Relay, LED and buzzer edges are logged. At the end it reports input
+ * to screen latency, relay on-time accuracy, lost encoder detents and
+ * Timer1 tick accounting. Script times are real time, the CPU clock can
+ * be detuned by -p <ppm> to model oscillator error in long soak runs.
+ *
+ * usage: sim_device <script> [-q] [-p ppm]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/wdt.h>
+#include <avr/power.h>
+
+#include "config.h"
+#include "rtos.h"
+
+#define CYCLES_PER_MS			(F_CPU / 1000.0 * clock_scale)
+#define CYCLES_TO_MS(c)			((double)(c) / CYCLES_PER_MS)
+#define MS_TO_CYCLES(ms)		((uint64_t)((ms) * CYCLES_PER_MS + 0.5))
+#define NS_TO_CYCLES(ns)		((uint64_t)(ns) * (F_CPU / 1000000UL) / 1000UL)
+#define NEVER					UINT64_MAX
+
+//-> Real CPU clock over nominal F_CPU, set from oscillator ppm error
+static	double		clock_scale = 1.0;
+
+
+/************************************************************************/
+/* FIRMWARE                                                             */
+/************************************************************************/
+extern	int			firmware_main(void);
+extern	uint64_t	host_cycles;
+extern	void		(*host_advance_hook)(uint64_t cycles);
+extern	void		(*host_irq_hook)(void);
+extern	uint32_t	host_eeprom_writes;
+
+//-> Interrupt vectors, missing ones stay NULL
+extern	void		TIMER1_COMPA_vect(void) __attribute__((weak));
+extern	void		TIMER1_COMPB_vect(void) __attribute__((weak));
+extern	void		TIMER0_COMPA_vect(void) __attribute__((weak));
+extern	void		TIMER0_COMPB_vect(void) __attribute__((weak));
+
+#if (RTOS_PROFILE_ENABLE)
+//-> Task names for profiler report
+extern	void		AUTO_InputScan(void) __attribute__((weak));
+extern	void		AUTO_ToggleOutputs(void) __attribute__((weak));
+extern	void		AUTO_DisplayUpdater(void) __attribute__((weak));
+extern	void		encProcessing(void) __attribute__((weak));
+extern	void		keyProcessing(void) __attribute__((weak));
+extern	void		buzzerStep(void) __attribute__((weak));
+extern	void		buzzerAlarm(void) __attribute__((weak));
+
+static const struct { TPTR task; const char *name; } task_names[] = {
+	{ AUTO_InputScan, "AUTO_InputScan" }, { AUTO_ToggleOutputs, "AUTO_ToggleOutputs" },
+	{ AUTO_DisplayUpdater, "AUTO_DisplayUpdater" },
+	{ encProcessing, "encProcessing" }, { keyProcessing, "keyProcessing" },
+	{ buzzerStep, "buzzerStep" }, { buzzerAlarm, "buzzerAlarm" },
+};
+#endif
+
+
+/************************************************************************/
+/* TIMERS                                                               */
+/************************************************************************/
+struct TIMER_MODEL
+{
+	uint32_t			phase;				// Prescaler phase in CPU cycles
+};
+
+static	struct		TIMER_MODEL		t0, t1;
+
+//-> Time spent with CPU clock divided by CLKPR and with back light pin PB0 high
+static	uint64_t	clock_slow_cycles, backlight_on_cycles;
+
+//-> Countdown tick accounting
+static	uint32_t	tick_matches,			// Timer1 compare A events
+					tick_serviced,			// TIMER1_COMPA_vect runs
+					tick_missed;			// Events lost, flag was still pending
+
+//------------------------------ Timer clock in full F_CPU cycles, CLKPR divides timer clock too
+static uint32_t prescaler(uint8_t tccrb)
+{
+	static const uint16_t div[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+	return (uint32_t)div[tccrb & 0x07] * host_clock_div();
+}
+
+//------------------------------ GTCCR PSR10 restarts prescaler shared by both timers
+static void prescaler_reset(void)
+{
+	if(!(GTCCR & (1<<PSR10))) return;
+	GTCCR &= ~(1<<PSR10);
+	t0.phase = 0;
+	t1.phase = 0;
+}
+
+//------------------------------ Timer clocks until compare flag is set
+static uint32_t ticks_to(uint32_t tcnt, uint32_t ocr, uint32_t top)
+{
+	// Flag is set one clock after counter matches, in CTC when it clears
+	uint32_t flag_at = (ocr + 1) % (top + 1);
+	if(tcnt > top) tcnt = top;
+	uint32_t d = (flag_at + (top + 1) - tcnt) % (top + 1);
+	return d ? d : top + 1;
+}
+
+//------------------------------ Cycles until next compare match of one timer
+static uint64_t timer_next(struct TIMER_MODEL *t, uint8_t tccrb, uint32_t tcnt, uint32_t top,
+							uint32_t ocra, uint32_t ocrb)
+{
+	uint32_t p = prescaler(tccrb);
+	if(!p) return NEVER;
+	uint32_t d = ticks_to(tcnt, ocra, top);
+	uint32_t db = ticks_to(tcnt, ocrb, top);
+	if(db < d) d = db;
+	return (uint64_t)(d - 1) * p + (p - t->phase);
+}
+
+//------------------------------ Move one timer, returns OCFnA/OCFnB bits which matched
+static uint8_t timer_step(struct TIMER_MODEL *t, uint8_t tccrb, uint32_t *tcnt, uint32_t top,
+							uint32_t ocra, uint32_t ocrb, uint64_t cycles, uint8_t fa, uint8_t fb)
+{
+	uint32_t p = prescaler(tccrb);
+	uint8_t flags = 0;
+	if(!p) return 0;
+
+	uint64_t total = t->phase + cycles;
+	uint32_t ticks = total / p;
+	t->phase = total % p;
+	if(!ticks) return 0;
+
+	// Steps never pass more than one match, see timer_next()
+	if(ticks == ticks_to(*tcnt, ocra, top)) flags |= fa;
+	if(ticks == ticks_to(*tcnt, ocrb, top)) flags |= fb;
+	*tcnt = ((*tcnt > top ? top : *tcnt) + ticks) % (top + 1);
+	return flags;
+}
+
+#define T0_TOP					((TCCR0A & (1<<WGM01)) ? OCR0A : 0xFF)
+#define T1_TOP					((TCCR1B & (1<<WGM12)) ? OCR1A : 0xFFFF)
+
+static uint64_t timers_next(void)
+{
+	uint64_t a = timer_next(&t0, TCCR0B, TCNT0, T0_TOP, OCR0A, OCR0B);
+	uint64_t b = timer_next(&t1, TCCR1B, TCNT1, T1_TOP, OCR1A, OCR1B);
+	return a < b ? a : b;
+}
+
+static void timers_step(uint64_t cycles)
+{
+	uint32_t c0 = TCNT0, c1 = TCNT1;
+	TIFR |= timer_step(&t0, TCCR0B, &c0, T0_TOP, OCR0A, OCR0B, cycles, 1<<OCF0A, 1<<OCF0B);
+	uint8_t f1 = timer_step(&t1, TCCR1B, &c1, T1_TOP, OCR1A, OCR1B, cycles, 1<<OCF1A, 1<<OCF1B);
+	if(f1 & (1<<OCF1A)) {
+		tick_matches++;
+		if(TIFR & (1<<OCF1A)) tick_missed++;
+	}
+	TIFR |= f1;
+	TCNT0 = c0;
+	TCNT1 = c1;
+}
+
+//------------------------------ Run pending enabled interrupts in vector order
+static void irq_dispatch(void)
+{
+	static const uint8_t flags[4] = { 1<<OCF1A, 1<<OCF1B, 1<<OCF0A, 1<<OCF0B };
+	void (*vectors[4])(void) = { TIMER1_COMPA_vect, TIMER1_COMPB_vect, TIMER0_COMPA_vect, TIMER0_COMPB_vect };
+	uint8_t again = 1;
+
+	while(host_sreg_i && again) {
+		again = 0;
+		for(int i = 0; i < 4; i++) {
+			uint8_t f = flags[i];
+			if(!(TIFR & f) || !(TIMSK & f) || !vectors[i]) continue;
+			// Hardware clears flag and I bit, RETI sets I back
+			TIFR &= ~f;
+			if(f == (1<<OCF1A)) tick_serviced++;
+			host_sreg_i = 0;
+			vectors[i]();
+			host_sreg_i = 1;
+			again = 1;
+			break;
+		}
+	}
+}
+
+
+/************************************************************************/
+/* HD44780 MODEL                                                        */
+/************************************************************************/
+#define LCD_EXEC_NS				37000UL			// Most instructions
+#define LCD_EXEC_LONG_NS		1520000UL		// Clear and home
+
+struct LCD_MODEL
+{
+	uint8_t				bus8,				// Interface is 8-bit after power on
+						nibble_pending,		// High nibble received in 4-bit mode
+						high,
+						e_prev,
+						addr,				// DDRAM address counter
+						display_on,
+						cursor_on,
+						increment;
+	uint64_t			busy_until;			// CPU cycle when current instruction is done
+	uint32_t			ignored;			// Strobes lost while busy
+	char				ddram[0x80];
+};
+
+static	struct		LCD_MODEL		lcd = { .bus8 = 1, .increment = 1 };
+
+static void lcd_execute(uint8_t rs, uint8_t b)
+{
+	uint64_t exec = NS_TO_CYCLES(LCD_EXEC_NS);
+
+	if(rs) {
+		lcd.ddram[lcd.addr & 0x7F] = b;
+		lcd.addr = (lcd.addr + (lcd.increment ? 1 : -1)) & 0x7F;
+	} else if(b & 0x80) {
+		lcd.addr = b & 0x7F;
+	} else if(b & 0x40) {
+		// CGRAM address, glyphs are not modelled
+	} else if(b & 0x20) {
+		lcd.bus8 = (b & 0x10) != 0;
+	} else if(b & 0x10) {
+		// Cursor/display shift, not used by firmware
+	} else if(b & 0x08) {
+		lcd.display_on = (b & 0x04) != 0;
+		lcd.cursor_on = (b & 0x02) != 0;
+	} else if(b & 0x04) {
+		lcd.increment = (b & 0x02) != 0;
+	} else if(b & 0x02) {
+		lcd.addr = 0;
+		exec = NS_TO_CYCLES(LCD_EXEC_LONG_NS);
+	} else if(b & 0x01) {
+		memset(lcd.ddram, ' ', sizeof(lcd.ddram));
+		lcd.addr = 0;
+		lcd.increment = 1;
+		exec = NS_TO_CYCLES(LCD_EXEC_LONG_NS);
+	}
+	lcd.busy_until = host_cycles + exec;
+}
+
+//------------------------------ Sample bus, every E strobe is followed by a busy-wait
+static void lcd_sample(void)
+{
+	uint8_t e = (PORTB & HD44780_IO_PIN_E_MASK) != 0;
+	uint8_t rs = (PORTB & HD44780_IO_PIN_RS_MASK) != 0;
+	uint8_t nibble = (PORTB >> HD44780_IO_DATA_SHIFT) & 0x0F;
+
+	if(e && !lcd.e_prev && !(PORTB & HD44780_IO_PIN_RW_MASK)) {
+		if(host_cycles < lcd.busy_until) {
+			lcd.ignored++;
+		} else if(lcd.bus8) {
+			// DB3..DB0 are not connected in 4-bit wiring
+			lcd_execute(rs, nibble << 4);
+		} else if(!lcd.nibble_pending) {
+			lcd.high = nibble;
+			lcd.nibble_pending = 1;
+		} else {
+			lcd.nibble_pending = 0;
+			lcd_execute(rs, lcd.high << 4 | nibble);
+		}
+	}
+	lcd.e_prev = e;
+}
+
+//------------------------------ Visible text of one row
+static void lcd_row(uint8_t row, char *out)
+{
+	for(int c = 0; c < HD44780_COLS; c++) {
+		char ch = lcd.ddram[(row ? 0x40 : 0x00) + c];
+		out[c] = (ch >= 0x20 && ch < 0x7F) ? ch : '?';
+	}
+	out[HD44780_COLS] = 0;
+}
+
+//------------------------------ Screen state as seen by operator
+static void lcd_snapshot(char *out)
+{
+	lcd_row(0, out);
+	lcd_row(1, out + HD44780_COLS + 1);
+	out[2 * HD44780_COLS + 1] = lcd.display_on;
+	out[2 * HD44780_COLS + 2] = lcd.cursor_on ? lcd.addr | 0x80 : 0;
+}
+
+static void lcd_print(void)
+{
+	char r0[HD44780_COLS + 1], r1[HD44780_COLS + 1];
+	lcd_row(0, r0);
+	lcd_row(1, r1);
+	printf("  +----------------+\n  |%s|\n  |%s|  cursor %s col %u\n  +----------------+\n",
+		r0, r1, lcd.cursor_on ? "on " : "off", lcd.addr & 0x3F);
+}
+
+
+/************************************************************************/
+/* SCRIPT                                                               */
+/************************************************************************/
+enum ACTION_ENUM
+{
+	ACT_PINS,					// Set PD0..PD2
+	ACT_INPUT,					// Input event completed, start latency measurement
+	ACT_TURN_BEGIN,				// Remember edited field value
+	ACT_TURN_CHECK,				// Compare field change with requested detents
+	ACT_RELAY,					// Expected relay on-time of next cycle
+	ACT_EXPECT,					// Compare screen row with text
+	ACT_OUTPUT,					// Compare relay pin with expected level
+	ACT_SHOW,					// Print screen
+	ACT_END
+};
+
+struct ACTION_STRUCT
+{
+	uint64_t			at;					// CPU cycle
+	uint32_t			seq;				// Script order of actions at same cycle
+	uint8_t				type;
+	int32_t				arg,
+						limit;				// Relay error limit in us, -1 - none
+	char				text[HD44780_COLS + 1];
+};
+
+static	struct		ACTION_STRUCT	*actions;
+static	uint32_t	actions_count, action_next;
+
+static struct ACTION_STRUCT *action_add(uint64_t at, uint8_t type, int32_t arg)
+{
+	actions = realloc(actions, (actions_count + 1) * sizeof(*actions));
+	struct ACTION_STRUCT *a = &actions[actions_count++];
+	memset(a, 0, sizeof(*a));
+	a->at = at;
+	a->seq = actions_count;
+	a->type = type;
+	a->arg = arg;
+	return a;
+}
+
+static int action_cmp(const void *x, const void *y)
+{
+	const struct ACTION_STRUCT *a = x, *b = y;
+	if(a->at != b->at) return a->at < b->at ? -1 : 1;
+	return a->seq < b->seq ? -1 : 1;
+}
+
+#define TURN_SETTLE_MS			300
+#define REPEAT_DEPTH			4
+#define PIN_BTN					(1<<2)
+#define PIN_ENC					(0x03)
+
+//------------------------------ Expand script commands into timed actions
+static int script_load(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	char line[128], cmd[16];
+	uint64_t t = 0;
+	uint8_t pins = PIN_BTN | PIN_ENC;
+	long repeat_at[REPEAT_DEPTH];
+	int repeat_left[REPEAT_DEPTH], depth = 0;
+	// Encoder states of one clockwise detent starting from rest state 3
+	static const uint8_t cw[4] = { 1, 0, 2, 3 }, ccw[4] = { 2, 0, 1, 3 };
+
+	if(!f) {
+		perror(path);
+		return -1;
+	}
+	action_add(0, ACT_PINS, pins);
+	while(fgets(line, sizeof(line), f)) {
+		double v1 = 0, v2 = 0;
+		int n = sscanf(line, "%15s %lf %lf", cmd, &v1, &v2);
+		if(n < 1 || cmd[0] == '#') continue;
+
+		if(!strcmp(cmd, "wait")) {
+			t += MS_TO_CYCLES(v1);
+		} else if(!strcmp(cmd, "press")) {
+			action_add(t, ACT_PINS, pins &= ~PIN_BTN);
+			t += MS_TO_CYCLES(v1);
+			action_add(t, ACT_PINS, pins |= PIN_BTN);
+			action_add(t, ACT_INPUT, 0);
+		} else if(!strcmp(cmd, "turn")) {
+			int detents = (int)v1;
+			const uint8_t *seq = detents < 0 ? ccw : cw;
+			action_add(t, ACT_TURN_BEGIN, 0);
+			for(int d = 0; d < abs(detents); d++) {
+				for(int e = 0; e < 4; e++) {
+					pins = (pins & ~PIN_ENC) | seq[e];
+					action_add(t, ACT_PINS, pins);
+					t += MS_TO_CYCLES(v2);
+				}
+				action_add(t, ACT_INPUT, 0);
+			}
+			// Check after display had time to refresh, next command starts after it
+			t += MS_TO_CYCLES(TURN_SETTLE_MS);
+			action_add(t, ACT_TURN_CHECK, detents);
+		} else if(!strcmp(cmd, "relay")) {
+			action_add(t, ACT_RELAY, (int32_t)(v1 * 1000))->limit = n > 2 ? (int32_t)(v2 * 1000) : -1;
+		} else if(!strcmp(cmd, "expect")) {
+			char *q = strchr(line, '"'), *e = q ? strchr(q + 1, '"') : NULL;
+			if(!e) goto bad;
+			struct ACTION_STRUCT *a = action_add(t, ACT_EXPECT, (int32_t)v1);
+			snprintf(a->text, sizeof(a->text), "%.*s", (int)(e - q - 1), q + 1);
+		} else if(!strcmp(cmd, "output")) {
+			action_add(t, ACT_OUTPUT, (int32_t)v1);
+		} else if(!strcmp(cmd, "show")) {
+			action_add(t, ACT_SHOW, 0);
+		} else if(!strcmp(cmd, "repeat")) {
+			if(depth == REPEAT_DEPTH || v1 < 1) goto bad;
+			repeat_at[depth] = ftell(f);
+			repeat_left[depth++] = (int)v1;
+		} else if(!strcmp(cmd, "done")) {
+			if(!depth) goto bad;
+			if(--repeat_left[depth - 1] > 0) {
+				fseek(f, repeat_at[depth - 1], SEEK_SET);
+			} else {
+				depth--;
+			}
+		} else {
+			goto bad;
+		}
+	}
+	fclose(f);
+	action_add(t, ACT_END, 0);
+	qsort(actions, actions_count, sizeof(*actions), action_cmp);
+	return 0;
+bad:
+	fprintf(stderr, "%s: bad line: %s", path, line);
+	fclose(f);
+	return -1;
+}
+
+
+/************************************************************************/
+/* METRICS                                                              */
+/************************************************************************/
+static	int			quiet;
+
+//-> Input to screen latency
+static	uint64_t	input_pending[64];
+static	uint32_t	input_pending_count, input_lost;
+static	uint32_t	lat_count;
+static	double		lat_min = 1e9, lat_max, lat_sum;
+static	char		screen_last[2 * HD44780_COLS + 3];
+
+//-> Relay accuracy, on-time and ticks are summed over pauses of one run
+static	int32_t		relay_expected_ms = -1;
+static	uint64_t	relay_on_at, relay_on_cycles;
+static	uint32_t	relay_ticks_at, relay_ticks;
+static	uint32_t	relay_cycles, relay_wrong_tick, relay_over_limit;
+static	int32_t		relay_limit_us = -1;
+static	double		relay_err_max;
+
+//-> Countdown shown on screen while relay is on
+static	int32_t		countdown_prev = -1;
+static	uint32_t	countdown_jumps;
+
+//-> Encoder
+static	int32_t		field_before;
+static	int32_t		detents_requested, detents_lost;
+
+//-> Checks
+static	uint32_t	expect_failed;
+static	uint8_t		portd_prev, tone_prev;
+
+//------------------------------ Log output edges
+static void outputs_sample(void)
+{
+	uint8_t tone = (TCCR0A & (1<<COM0B0)) != 0;
+	uint8_t changed = (PORTD ^ portd_prev) & (RELAY_MASK | TICK_LED_MASK | BUZZER_MASK);
+	double now = CYCLES_TO_MS(host_cycles);
+
+	if(changed & RELAY_MASK) {
+		uint8_t on = (PORTD & RELAY_MASK) != 0;
+		if(!quiet) printf("%12.3f ms  RELAY  %s\n", now, on ? "on" : "off");
+		if(on) {
+			relay_on_at = host_cycles;
+			relay_ticks_at = tick_serviced;
+		} else {
+			relay_on_cycles += host_cycles - relay_on_at;
+			relay_ticks += tick_serviced - relay_ticks_at;
+			countdown_prev = -1;
+		}
+		// Paused run is checked when it has collected all ticks
+		if(!on && relay_expected_ms >= 0 && relay_ticks * 1000LL >= relay_expected_ms) {
+			double err = CYCLES_TO_MS(relay_on_cycles) - relay_expected_ms;
+			printf("%12.3f ms  RELAY  on for %.3f ms, expected %d ms, error %+.3f ms (%+.1f ppm), %u ticks\n",
+				now, CYCLES_TO_MS(relay_on_cycles), relay_expected_ms, err, err * 1e6 / relay_expected_ms, relay_ticks);
+			if(relay_ticks * 1000LL != relay_expected_ms) {
+				printf("%12.3f ms  RELAY  off at tick %u, expected tick %d  FAILED\n",
+					now, relay_ticks, relay_expected_ms / 1000);
+				relay_wrong_tick++;
+			}
+			if(err < 0) err = -err;
+			if(relay_limit_us >= 0 && err * 1000 > relay_limit_us) {
+				printf("%12.3f ms  RELAY  error over %.3f ms  FAILED\n", now, relay_limit_us / 1000.0);
+				relay_over_limit++;
+			}
+			if(err > relay_err_max) relay_err_max = err;
+			relay_cycles++;
+			relay_expected_ms = -1;
+		}
+	}
+#if (CHANNELS_COUNT > 1)
+	if(!quiet && ((PORTD ^ portd_prev) & CHANNEL1_MASK)) printf("%12.3f ms  OUT1   %s\n", now, (PORTD & CHANNEL1_MASK) ? "on" : "off");
+#endif
+	if(!quiet && (changed & TICK_LED_MASK)) printf("%12.3f ms  LED    %s\n", now, (PORTD & TICK_LED_MASK) ? "on" : "off");
+	if(!quiet && ((changed & BUZZER_MASK) || tone != tone_prev)) {
+		printf("%12.3f ms  BUZZER %s\n", now, tone ? "tone" : (PORTD & BUZZER_MASK) ? "on" : "off");
+	}
+	portd_prev = PORTD;
+	tone_prev = tone;
+}
+
+//------------------------------ Column of cursor on settled screen, -1 if hidden
+static int field_column(void)
+{
+	uint8_t cursor = screen_last[2 * HD44780_COLS + 2];
+	return (cursor & 0x80) ? (cursor & 0x3F) : -1;
+}
+
+//------------------------------ Value of field under cursor, -1 if no field is edited
+static int32_t field_value(void)
+{
+	const char *r1 = screen_last + HD44780_COLS + 1;
+	int col = field_column();
+	if(col != 1 && col != 4 && col != 7) return -1;
+	return (r1[col - 1] - '0') * 10 + (r1[col] - '0');
+}
+
+static void report(void)
+{
+	printf("\n");
+	lcd_print();
+	printf("\nsimulated time            %.3f s\n", CYCLES_TO_MS(host_cycles) / 1000);
+	if(lat_count) {
+		printf("input to screen latency   n=%u min=%.3f avg=%.3f max=%.3f ms\n",
+			lat_count, lat_min, lat_sum / lat_count, lat_max);
+	}
+	printf("inputs without response   %u\n", input_lost + input_pending_count);
+	printf("relay cycles checked      %u, max error %.3f ms\n", relay_cycles, relay_err_max);
+	if(relay_expected_ms >= 0) {
+		printf("relay run unfinished      %u of %d ticks\n", relay_ticks, relay_expected_ms / 1000);
+	}
+	printf("relay off at wrong tick   %u\n", relay_wrong_tick);
+	printf("relay error over limit    %u\n", relay_over_limit);
+	printf("oscillator error          %+.1f ppm\n", (clock_scale - 1.0) * 1e6);
+	printf("countdown ticks           %u matched, %u serviced, %u missed, %u doubled\n",
+		tick_matches, tick_serviced, tick_missed,
+		tick_serviced > tick_matches - tick_missed ? tick_serviced - (tick_matches - tick_missed) : 0);
+	printf("countdown display jumps   %u\n", countdown_jumps);
+	printf("encoder detents           requested %d, lost %d\n", detents_requested, detents_lost);
+	printf("LCD strobes while busy    %u\n", lcd.ignored);
+	printf("EEPROM bytes written      %u\n", host_eeprom_writes);
+	printf("CPU clock divided         %.1f %% of time\n", host_cycles ? 100.0 * clock_slow_cycles / host_cycles : 0.0);
+	printf("back light on             %.1f %% of time\n", host_cycles ? 100.0 * backlight_on_cycles / host_cycles : 0.0);
+#if (RTOS_DROPS_ENABLE)
+	printf("RTOS queue full           run %u, timer %u\n", RTOS_TaskDrops, RTOS_TimerDrops);
+#endif
+	printf("expect failures           %u\n", expect_failed);
+#if (RTOS_PROFILE_ENABLE)
+	// Units as on diagnostics pages: 8us counter ticks, lateness in systicks
+	printf("profiler ISR max          T0 %u, T1 %u ticks\n",
+		RTOS_ProfileIsr[RTOS_PROFILE_ISR_SYSTICK], RTOS_ProfileIsr[RTOS_PROFILE_ISR_TICK]);
+	for(int i = 0; i < RTOS_PROFILE_SLOTS && RTOS_Profile[i].task; i++) {
+		const char *name = "?";
+		for(size_t n = 0; n < sizeof(task_names) / sizeof(task_names[0]); n++) {
+			if(task_names[n].task == RTOS_Profile[i].task) name = task_names[n].name;
+		}
+		printf("profiler task             %-20s run max %3u avg %3u ticks, late max %3u ms\n", name,
+			RTOS_Profile[i].run_max, RTOS_Profile[i].run_avg >> 3, RTOS_Profile[i].late_max);
+	}
+#endif
+}
+
+//------------------------------ Any check of the run failed
+static int failed(void)
+{
+	return expect_failed || relay_wrong_tick || relay_over_limit || relay_expected_ms >= 0 ||
+		tick_missed || tick_serviced > tick_matches || countdown_jumps
+#if (RTOS_DROPS_ENABLE)
+		|| RTOS_TimerDrops
+#endif
+		;
+}
+
+static void actions_run(void)
+{
+	while(action_next < actions_count && actions[action_next].at <= host_cycles) {
+		struct ACTION_STRUCT *a = &actions[action_next++];
+		char row[HD44780_COLS + 1];
+
+		switch(a->type) {
+			case ACT_PINS:
+				PIND = (PIND & ~(PIN_BTN | PIN_ENC)) | a->arg;
+				break;
+			case ACT_INPUT:
+				if(input_pending_count < sizeof(input_pending) / sizeof(input_pending[0])) {
+					input_pending[input_pending_count++] = host_cycles;
+				} else {
+					input_lost++;
+				}
+				break;
+			case ACT_TURN_BEGIN:
+				field_before = field_value();
+				break;
+			case ACT_TURN_CHECK: {
+				int32_t after = field_value();
+				if(field_before < 0 || after < 0) {
+					if(!quiet) printf("%12.3f ms  TURN   no field in edit, %d detents not checked\n", CYCLES_TO_MS(host_cycles), a->arg);
+					break;
+				}
+				// Wrap limits of the edited field: hours 0..47, minutes and seconds 0..59
+				int32_t range = (field_column() == 1) ? 48 : 60;
+				detents_requested += abs(a->arg);
+				int32_t expect = ((field_before + a->arg) % range + range) % range;
+				int32_t lost = ((expect - after) % range + range) % range;
+				if(lost > range / 2) lost = range - lost;
+#if (ENC_ACCEL_ENABLE)
+				// Accelerated detents step more than one, only a short move is a sure loss
+				int32_t moved = (((after - field_before) * (a->arg < 0 ? -1 : 1)) % range + range) % range;
+				lost = abs(a->arg) > moved ? abs(a->arg) - moved : 0;
+#endif
+				detents_lost += lost;
+				if(!quiet || lost) {
+					printf("%12.3f ms  TURN   %+d detents, field %d -> %d, lost %d\n",
+						CYCLES_TO_MS(host_cycles), a->arg, field_before, after, lost);
+				}
+				break;
+			}
+			case ACT_RELAY:
+				relay_expected_ms = a->arg;
+				relay_limit_us = a->limit;
+				relay_on_cycles = 0;
+				relay_ticks = 0;
+				break;
+			case ACT_EXPECT:
+				lcd_row(a->arg, row);
+				if(strncmp(row, a->text, strlen(a->text))) {
+					printf("%12.3f ms  EXPECT row %d \"%s\", screen \"%s\"  FAILED\n",
+						CYCLES_TO_MS(host_cycles), a->arg, a->text, row);
+					expect_failed++;
+				}
+				break;
+			case ACT_OUTPUT:
+				if(((PORTD & RELAY_MASK) != 0) != a->arg) {
+					printf("%12.3f ms  EXPECT relay %s  FAILED\n", CYCLES_TO_MS(host_cycles), a->arg ? "on" : "off");
+					expect_failed++;
+				}
+				break;
+			case ACT_SHOW:
+				printf("%12.3f ms  SCREEN\n", CYCLES_TO_MS(host_cycles));
+				lcd_print();
+				break;
+			case ACT_END:
+				report();
+				exit(failed() ? 1 : 0);
+		}
+	}
+}
+
+
+/************************************************************************/
+/* VIRTUAL CLOCK                                                        */
+/************************************************************************/
+//------------------------------ Watchdog runs on its own 128 kHz oscillator, timeout is real time
+static void wdt_check(void)
+{
+	if(!host_wdt_timeout || CYCLES_TO_MS(host_cycles - host_wdt_fed) < (16 << (host_wdt_timeout - 1))) return;
+	printf("%12.3f ms  WDT    reset, not fed for %.3f ms\n", CYCLES_TO_MS(host_cycles), CYCLES_TO_MS(host_cycles - host_wdt_fed));
+	report();
+	exit(1);
+}
+
+//------------------------------ Move virtual time, peripherals and interrupts with it
+static void advance(uint64_t cycles)
+{
+	uint64_t target = host_cycles + cycles;
+
+	prescaler_reset();
+	lcd_sample();
+	outputs_sample();
+	while(host_cycles < target) {
+		uint64_t step = target - host_cycles;
+		uint64_t next = timers_next();
+		if(next < step) step = next;
+		if(action_next < actions_count && actions[action_next].at - host_cycles < step) {
+			step = actions[action_next].at > host_cycles ? actions[action_next].at - host_cycles : 0;
+		}
+		if(step) {
+			timers_step(step);
+			host_cycles += step;
+			if(host_clock_div() > 1) clock_slow_cycles += step;
+			if(PORTB & (1<<0)) backlight_on_cycles += step;
+		}
+		actions_run();
+		irq_dispatch();
+		outputs_sample();
+		wdt_check();
+	}
+}
+
+//------------------------------ Shown countdown must go down one second per change
+static void countdown_check(void)
+{
+	const char *r1 = screen_last + HD44780_COLS + 1;
+	int h, m, sec;
+
+	if(!(PORTD & RELAY_MASK) || sscanf(r1, "%2d:%2d:%2d", &h, &m, &sec) != 3) return;
+#if (CHANNELS_COUNT > 1)
+	// Only relay channel is followed, other channels start it over
+	if(screen_last[8] != '1') {
+		countdown_prev = -1;
+		return;
+	}
+#endif
+	int32_t now = h * 3600 + m * 60 + sec;
+	if(countdown_prev >= 0 && now != countdown_prev && now != countdown_prev - 1) {
+		printf("%12.3f ms  SCREEN countdown %d -> %d s\n", CYCLES_TO_MS(host_cycles), countdown_prev, now);
+		countdown_jumps++;
+	}
+	countdown_prev = now;
+}
+
+//------------------------------ RTOS idle: CPU waits for the next event
+void Idle(void)
+{
+	char snap[sizeof(screen_last)];
+
+	// Screen is settled when all tasks are done
+	lcd_snapshot(snap);
+	if(memcmp(snap, screen_last, sizeof(snap))) {
+		memcpy(screen_last, snap, sizeof(snap));
+		for(uint32_t i = 0; i < input_pending_count; i++) {
+			double l = CYCLES_TO_MS(host_cycles - input_pending[i]);
+			if(l < lat_min) lat_min = l;
+			if(l > lat_max) lat_max = l;
+			lat_sum += l;
+			lat_count++;
+		}
+		input_pending_count = 0;
+		countdown_check();
+	}
+
+	prescaler_reset();
+	uint64_t step = timers_next();
+	if(action_next < actions_count) {
+		uint64_t a = actions[action_next].at - host_cycles;
+		if(actions[action_next].at <= host_cycles) a = 0;
+		if(a < step) step = a;
+	}
+	if(step == NEVER) {
+		fprintf(stderr, "no more events, firmware is stuck\n");
+		report();
+		exit(2);
+	}
+	advance(step ? step : 1);
+}
+
+int main(int argc, char *argv[])
+{
+	if(argc < 2) {
+		fprintf(stderr, "usage: %s script.txt [-q] [-p ppm]\n", argv[0]);
+		return 2;
+	}
+	for(int i = 2; i < argc; i++) {
+		if(!strcmp(argv[i], "-q")) {
+			quiet = 1;
+		} else if(!strcmp(argv[i], "-p") && i + 1 < argc) {
+			clock_scale = 1.0 + atof(argv[++i]) * 1e-6;
+		}
+	}
+	if(script_load(argv[1])) return 2;
+
+	memset(lcd.ddram, ' ', sizeof(lcd.ddram));
+	// Encoder and button lines idle high on their pull-ups
+	PIND = PIN_BTN | PIN_ENC;
+	host_advance_hook = advance;
+	host_irq_hook = irq_dispatch;
+	actions_run();
+
+	return firmware_main();
+}
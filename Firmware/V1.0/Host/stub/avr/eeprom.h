@@ -0,0 +1,57 @@
+/*
+ * avr/eeprom.h
+ *
+ * Host stub: EEMEM variables are ordinary RAM, EEPROM stays busy for
+ * the real 3.4 ms per byte of virtual time after a write.
+ */
+#ifndef HOST_AVR_EEPROM_H
+#define HOST_AVR_EEPROM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+extern	uint8_t		host_eeprom_ready(void);
+extern	void		host_eeprom_write_start(void);
+extern	uint32_t	host_eeprom_writes;					// Bytes written since start
+
+#ifndef EEMEM
+#define EEMEM
+#endif
+
+#define eeprom_is_ready()		host_eeprom_ready()
+#define eeprom_busy_wait()		while(!eeprom_is_ready())
+
+static inline void eeprom_read_block(void *dst, const void *src, size_t n)
+{
+	eeprom_busy_wait();
+	memcpy(dst, src, n);
+}
+
+static inline uint8_t eeprom_read_byte(const uint8_t *p)
+{
+	eeprom_busy_wait();
+	return *p;
+}
+
+static inline void eeprom_write_byte(uint8_t *p, uint8_t value)
+{
+	eeprom_busy_wait();
+	*p = value;
+	host_eeprom_writes++;
+	host_eeprom_write_start();
+}
+
+static inline void eeprom_write_block(const void *src, void *dst, size_t n)
+{
+	for(size_t i = 0; i < n; i++) eeprom_write_byte((uint8_t *)dst + i, ((const uint8_t *)src)[i]);
+}
+
+static inline void eeprom_update_block(const void *src, void *dst, size_t n)
+{
+	for(size_t i = 0; i < n; i++) {
+		if(((uint8_t *)dst)[i] != ((const uint8_t *)src)[i]) eeprom_write_byte((uint8_t *)dst + i, ((const uint8_t *)src)[i]);
+	}
+}
+
+#endif
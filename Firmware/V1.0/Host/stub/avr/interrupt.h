@@ -0,0 +1,19 @@
+/*
+ * avr/interrupt.h
+ *
+ * Host stub of global interrupt control. The I flag is a variable, ISRs
+ * become plain functions called by the host harness.
+ */
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+#include <stdint.h>
+
+extern	volatile	uint8_t		host_sreg_i;		// Global interrupt enable flag
+extern	void		host_sei(void);
+
+#define cli()					{ host_sreg_i = 0; }
+#define sei()					host_sei()
+#define ISR(vector)				void vector(void)
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ * avr/io.h
+ *
+ * Host stub of ATtiny2313A I/O registers. Registers are plain variables
+ * defined in stub/host.c, so firmware sources build and run on Linux.
+ */
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+#include <stdint.h>
+
+#define RAMEND					0xDF
+
+//------------------------------ 8-bit registers
+extern	volatile	uint8_t		PINA, DDRA, PORTA;
+extern	volatile	uint8_t		PINB, DDRB, PORTB;
+extern	volatile	uint8_t		PIND, DDRD, PORTD;
+extern	volatile	uint8_t		TCCR0A, TCCR0B, TCNT0, OCR0A, OCR0B;
+extern	volatile	uint8_t		TCCR1A, TCCR1B, TCCR1C;
+extern	volatile	uint8_t		TIMSK, TIFR, GTCCR;
+extern	volatile	uint8_t		CLKPR, MCUSR, WDTCR, MCUCR;
+extern	volatile	uint8_t		EECR;
+//------------------------------ 16-bit registers
+extern	volatile	uint16_t	TCNT1, OCR1A, OCR1B, ICR1;
+
+//------------------------------ TCCR0A
+#define WGM00	0
+#define WGM01	1
+#define COM0B0	4
+#define COM0B1	5
+#define COM0A0	6
+#define COM0A1	7
+//------------------------------ TCCR0B
+#define CS00	0
+#define CS01	1
+#define CS02	2
+#define WGM02	3
+//------------------------------ TCCR1A
+#define WGM10	0
+#define WGM11	1
+#define COM1B0	4
+#define COM1B1	5
+#define COM1A0	6
+#define COM1A1	7
+//------------------------------ TCCR1B
+#define CS10	0
+#define CS11	1
+#define CS12	2
+#define WGM12	3
+#define WGM13	4
+//------------------------------ TIMSK / TIFR
+#define OCIE0A	0
+#define TOIE0	1
+#define OCIE0B	2
+#define ICIE1	3
+#define OCIE1B	5
+#define OCIE1A	6
+#define TOIE1	7
+#define OCF0A	0
+#define TOV0	1
+#define OCF0B	2
+#define OCF1B	5
+#define OCF1A	6
+//------------------------------ GTCCR
+#define PSR10	0
+//------------------------------ CLKPR
+#define CLKPS0	0
+#define CLKPCE	7
+//------------------------------ MCUSR
+#define PORF	0
+#define EXTRF	1
+#define BORF	2
+#define WDRF	3
+//------------------------------ WDTCR
+#define WDE		3
+#define WDCE	4
+#define WDIE	6
+//------------------------------ MCUCR
+#define SE		5
+#define SM0		4
+
+#endif
@@ -0,0 +1,30 @@
+/*
+ * avr/power.h
+ *
+ * Host stub: clock_prescale_set() writes CLKPR like the real one. Busy
+ * waits of stub/host.c and harness timers are slowed by the divider.
+ */
+#ifndef HOST_AVR_POWER_H
+#define HOST_AVR_POWER_H
+
+#include <avr/io.h>
+
+typedef enum
+{
+	clock_div_1 = 0,
+	clock_div_2 = 1,
+	clock_div_4 = 2,
+	clock_div_8 = 3,
+	clock_div_16 = 4,
+	clock_div_32 = 5,
+	clock_div_64 = 6,
+	clock_div_128 = 7,
+	clock_div_256 = 8
+} clock_div_t;
+
+extern	uint16_t	host_clock_div(void);
+
+#define clock_prescale_set(x)	{ CLKPR = 1<<CLKPCE; CLKPR = (x); }
+#define clock_prescale_get()	((clock_div_t)(CLKPR & 0x0F))
+
+#endif
@@ -0,0 +1,31 @@
+/*
+ * avr/wdt.h
+ *
+ * Host stub: watchdog state is kept in variables of stub/host.c, a
+ * harness checks host_wdt_fed against the timeout in virtual time.
+ */
+#ifndef HOST_AVR_WDT_H
+#define HOST_AVR_WDT_H
+
+#include <stdint.h>
+
+extern	uint8_t		host_wdt_timeout;					// WDTO_x + 1, 0 when stopped
+extern	uint64_t	host_wdt_fed;						// CPU cycle of last wdt_reset()
+extern	uint64_t	host_cycles;
+
+#define WDTO_15MS				0
+#define WDTO_30MS				1
+#define WDTO_60MS				2
+#define WDTO_120MS				3
+#define WDTO_250MS				4
+#define WDTO_500MS				5
+#define WDTO_1S					6
+#define WDTO_2S					7
+#define WDTO_4S					8
+#define WDTO_8S					9
+
+#define wdt_reset()				{ host_wdt_fed = host_cycles; }
+#define wdt_enable(timeout)		{ host_wdt_timeout = (timeout) + 1; host_wdt_fed = host_cycles; }
+#define wdt_disable()			{ host_wdt_timeout = 0; }
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * host.c
+ *
+ * Register file and virtual CPU clock of the host stub layer. Harnesses
+ * which model peripherals install the hooks, plain builds run without.
+ */
+#include "config.h"
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stddef.h>
+
+#define EEPROM_WRITE_CYCLES		((uint64_t)(F_CPU * 0.0034))	// 3.4 ms per byte
+
+volatile	uint8_t		PINA, DDRA, PORTA;
+volatile	uint8_t		PINB, DDRB, PORTB;
+volatile	uint8_t		PIND, DDRD, PORTD;
+volatile	uint8_t		TCCR0A, TCCR0B, TCNT0, OCR0A, OCR0B;
+volatile	uint8_t		TCCR1A, TCCR1B, TCCR1C;
+volatile	uint8_t		TIMSK, TIFR, GTCCR;
+volatile	uint8_t		CLKPR, MCUSR, WDTCR, MCUCR;
+volatile	uint8_t		EECR;
+volatile	uint16_t	TCNT1, OCR1A, OCR1B, ICR1;
+
+volatile	uint8_t		host_sreg_i;
+
+uint64_t			host_cycles;						// Virtual time in cycles of full F_CPU
+uint32_t			host_eeprom_writes;
+uint64_t			host_eeprom_busy_until;				// CPU cycle when last byte write ends
+uint8_t				host_wdt_timeout;					// WDTO_x + 1, 0 when stopped
+uint64_t			host_wdt_fed;						// CPU cycle of last wdt_reset()
+void				(*host_advance_hook)(uint64_t cycles);	// Move virtual time and peripherals
+void				(*host_irq_hook)(void);				// Dispatch pending interrupts
+
+//------------------------------ Global interrupt enable, pending interrupts run now
+void host_sei(void)
+{
+	host_sreg_i = 1;
+	if(host_irq_hook) host_irq_hook();
+}
+
+//------------------------------ CPU clock divider set through CLKPR
+uint16_t host_clock_div(void)
+{
+	return 1 << (CLKPR & 0x0F);
+}
+
+//------------------------------ Move virtual time, counted in cycles of full F_CPU
+static void host_advance(uint64_t cycles)
+{
+	if(host_advance_hook) {
+		host_advance_hook(cycles);
+	} else {
+		host_cycles += cycles;
+	}
+}
+
+//------------------------------ Busy wait, interrupts may run meanwhile
+void host_delay_cycles(uint64_t cycles)
+{
+	// Loop length is fixed in CPU cycles, slower clock stretches it
+	host_advance(cycles * host_clock_div());
+}
+
+//------------------------------ EEPROM byte write runs on own oscillator while CPU goes on
+void host_eeprom_write_start(void)
+{
+	host_eeprom_busy_until = host_cycles + EEPROM_WRITE_CYCLES;
+}
+
+//------------------------------ EEPROMReady bit, a poll takes a few cycles
+uint8_t host_eeprom_ready(void)
+{
+	if(host_cycles >= host_eeprom_busy_until) return 1;
+	host_delay_cycles(4);
+	return 0;
+}
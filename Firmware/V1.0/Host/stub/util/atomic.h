@@ -0,0 +1,33 @@
+/*
+ * util/atomic.h
+ *
+ * Host stub of ATOMIC_BLOCK built on the stub I flag. Like avr-libc it
+ * restores the flag with a cleanup handler, so return inside works.
+ */
+#ifndef HOST_UTIL_ATOMIC_H
+#define HOST_UTIL_ATOMIC_H
+
+#include <avr/interrupt.h>
+
+static inline uint8_t host_atomic_cli(void)
+{
+	host_sreg_i = 0;
+	return 1;
+}
+
+static inline void host_atomic_restore(const uint8_t *save)
+{
+	if(*save) host_sei();
+}
+
+static inline void host_atomic_sei(const uint8_t *save)
+{
+	(void)save;
+	host_sei();
+}
+
+#define ATOMIC_RESTORESTATE		uint8_t host_atomic_save __attribute__((cleanup(host_atomic_restore))) = host_sreg_i
+#define ATOMIC_FORCEON			uint8_t host_atomic_save __attribute__((cleanup(host_atomic_sei))) = 0
+#define ATOMIC_BLOCK(type)		for(type, host_atomic_todo = host_atomic_cli(); host_atomic_todo; host_atomic_todo = 0)
+
+#endif
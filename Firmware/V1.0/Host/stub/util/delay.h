@@ -0,0 +1,21 @@
+/*
+ * util/delay.h
+ *
+ * Host stub: busy-wait delays advance the virtual CPU clock. Like the
+ * real macros the cycle count is fixed by F_CPU at compile time.
+ */
+#ifndef HOST_UTIL_DELAY_H
+#define HOST_UTIL_DELAY_H
+
+#include <stdint.h>
+
+#ifndef F_CPU
+	#error "F_CPU must be defined before util/delay.h"
+#endif
+
+extern	void		host_delay_cycles(uint64_t cycles);
+
+#define _delay_us(us)			host_delay_cycles((uint64_t)((us) * (F_CPU / 1000000.0)))
+#define _delay_ms(ms)			host_delay_cycles((uint64_t)((ms) * (F_CPU / 1000.0)))
+
+#endif
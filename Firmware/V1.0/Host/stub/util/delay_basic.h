@@ -0,0 +1,16 @@
+/*
+ * util/delay_basic.h
+ *
+ * Host stub: counted loops advance the virtual CPU clock by their cycles.
+ */
+#ifndef HOST_UTIL_DELAY_BASIC_H
+#define HOST_UTIL_DELAY_BASIC_H
+
+#include <stdint.h>
+
+extern	void		host_delay_cycles(uint64_t cycles);
+
+#define _delay_loop_1(count)	host_delay_cycles(3ULL * ((count) ? (count) : 256))
+#define _delay_loop_2(count)	host_delay_cycles(4ULL * ((count) ? (count) : 65536))
+
+#endif
@@ -0,0 +1,144 @@
+/*
+ * trace_decode.c
+ *
+ * Turns the binary trace captured from PD6 (TRACE_ENABLE) into a
+ * timeline. Capture with any USB-UART at TRACE_BAUD 8N1, for example
+ *   stty -F /dev/ttyUSB0 115200 raw && cat /dev/ttyUSB0 > trace.bin
+ * Task IDs are resolved with `avr-nm SimpleTime.elf > names.txt`.
+ *
+ * usage: trace_decode <trace.bin|-> [names.txt]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "config.h"
+#include "trace.h"
+
+#define US_PER_COUNT			(SYSTICK_PRESCALER * 1000000.0 / F_CPU)
+
+/************************************************************************/
+/* VARS                                                                 */
+/************************************************************************/
+static	const	char	*event_names[TRACE_EVENTS_COUNT] = {
+	[TRACE_EVENT_ISR_ENTER]	= "ISR>",
+	[TRACE_EVENT_ISR_EXIT]	= "ISR<",
+	[TRACE_EVENT_TIMER]		= "TIMER",
+	[TRACE_EVENT_TASK]		= "TASK",
+	[TRACE_EVENT_RELAY]		= "RELAY",
+	[TRACE_EVENT_EEPROM]	= "EEPROM",
+	[TRACE_EVENT_LOST]		= "LOST",
+};
+
+static	const	char	*isr_names[] = { "systick", "tick" };
+
+//-> Function names by task ID, several functions may share one ID
+static	char		task_names[256][64];
+
+
+/************************************************************************/
+/* FUNCTIONS                                                            */
+/************************************************************************/
+//------------------------------ Read avr-nm output, ID is low byte of word address
+static void names_load(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	char line[256], type, name[128];
+	unsigned long address;
+
+	if(!f) {
+		perror(path);
+		exit(2);
+	}
+	while(fgets(line, sizeof(line), f)) {
+		if(sscanf(line, "%lx %c %127s", &address, &type, name) != 3) continue;
+		if(type != 'T' && type != 't') continue;
+		char *n = task_names[(address >> 1) & 0xFF];
+		size_t used = strlen(n);
+		snprintf(n + used, sizeof(task_names[0]) - used, "%s%s", used ? "|" : "", name);
+	}
+	fclose(f);
+}
+
+static const char *task_name(uint8_t id)
+{
+	static char buffer[8];
+	if(task_names[id][0]) return task_names[id];
+	snprintf(buffer, sizeof(buffer), "id %02X", id);
+	return buffer;
+}
+
+int main(int argc, char *argv[])
+{
+	FILE *f;
+	uint8_t r[3];
+	uint32_t ms = 0, records = 0, skipped = 0, lost = 0;
+	double isr_enter[2] = { -1, -1 };
+
+	if(argc < 2) {
+		fprintf(stderr, "usage: %s <trace.bin|-> [names.txt]\n", argv[0]);
+		return 2;
+	}
+	f = strcmp(argv[1], "-") ? fopen(argv[1], "rb") : stdin;
+	if(!f) {
+		perror(argv[1]);
+		return 2;
+	}
+	if(argc > 2) names_load(argv[2]);
+
+	// Records start with 0x80 | event, resync byte by byte on garbage
+	size_t have = 0;
+	for(;;) {
+		have += fread(r + have, 1, sizeof(r) - have, f);
+		if(have < sizeof(r)) break;
+		if(!(r[0] & 0x80) || (r[0] & 0x7F) >= TRACE_EVENTS_COUNT) {
+			memmove(r, r + 1, --have);
+			skipped++;
+			continue;
+		}
+		have = 0;
+		records++;
+
+		uint8_t event = r[0] & 0x7F, arg = r[1];
+		// Milliseconds are counted by systick entries, counter gives the fraction
+		if(event == TRACE_EVENT_ISR_ENTER && arg == TRACE_ISR_SYSTICK) ms++;
+		double t = ms + r[2] * US_PER_COUNT / 1000.0;
+
+		printf("%12.3f ms  %-6s ", t, event_names[event]);
+		switch(event) {
+			case TRACE_EVENT_ISR_ENTER:
+			case TRACE_EVENT_ISR_EXIT:
+				if(arg > TRACE_ISR_TICK) {
+					printf("vector %u\n", arg);
+					break;
+				}
+				printf("%s", isr_names[arg]);
+				if(event == TRACE_EVENT_ISR_ENTER) {
+					isr_enter[arg] = t;
+				} else if(isr_enter[arg] >= 0) {
+					printf(", %.0f us", (t - isr_enter[arg]) * 1000.0);
+					isr_enter[arg] = -1;
+				}
+				printf("\n");
+				break;
+			case TRACE_EVENT_TIMER:
+			case TRACE_EVENT_TASK:
+				printf("%s\n", task_name(arg));
+				break;
+			case TRACE_EVENT_RELAY:
+				printf("ch %u %s\n", arg >> 1, (arg & 1) ? "on" : "off");
+				break;
+			case TRACE_EVENT_EEPROM:
+				printf("%u bytes\n", arg);
+				break;
+			case TRACE_EVENT_LOST:
+				printf("%u records, timeline may slip\n", arg);
+				lost += arg;
+				break;
+		}
+	}
+
+	fprintf(stderr, "%u records, %u records lost on device, %u bytes skipped\n", records, lost, skipped);
+	return 0;
+}
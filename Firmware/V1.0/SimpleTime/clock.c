@@ -0,0 +1,69 @@
+/*
+ * clock.c
+ *
+ * Created: 19.10.2026 17:21:19
+ *  CPU clock scaling
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <avr/io.h>
+#include <avr/power.h>
+#include <util/atomic.h>
+#include <util/delay_basic.h>
+
+#include "clock.h"
+
+#if (CLOCK_SCALE_ENABLE)
+#if (TRACE_ENABLE || RTOS_PROFILE_ENABLE)
+	#error "Trace UART and profiler count CPU cycles, disable CLOCK_SCALE_ENABLE"
+#endif
+#if (SYSTICK_SLOW_PRESCALER * CLOCK_SLOW_FACTOR != 2 * SYSTICK_PRESCALER) || ((SYSTICK_OCR_CONST + 1) & 1)
+	#error "Systick rescale expects slow counts twice as long and an even period"
+#endif
+
+/************************************************************************/
+/* VARS                                                                 */
+/************************************************************************/
+uint8_t				clock_slow;						// Current clock, 0 - F_CPU
+
+
+/************************************************************************/
+/* FUNCTIONS                                                            */
+/************************************************************************/
+//------------------------------ Switch CPU clock, timers keep time base
+void clock_Set(uint8_t slow)
+{
+	uint8_t count;
+
+	if(slow == clock_slow) return;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		// Countdown timer counts on a prescaler boundary. Switching right
+		// after a count and restarting the prescaler costs only the cycles
+		// from here to GTCCR write, the second keeps its length otherwise
+		if(TIMER_TICK_CHECK) {
+			count = TIMER_TICK_COUNTER_REG;
+			while((uint8_t)TIMER_TICK_COUNTER_REG == count) _delay_loop_1(1);
+			TCCR1B = (TCCR1B & ~(1<<CS12|1<<CS11|1<<CS10)) | (slow ? TIMER_TICK_SLOW_CS : TIMER_TICK_FAST_CS);
+		}
+		clock_prescale_set(slow ? CLOCK_SLOW_DIV : clock_div_1);
+		GTCCR = 1<<PSR10;
+
+		// Systick counts twice as long on slow clock, phase and back light
+		// PWM duty are kept
+		if(slow) {
+			SYSTICK_TIMER_COUNTER >>= 1;
+			OCR0B >>= 1;
+			SYSTICK_TIMER_OCR = SYSTICK_SLOW_OCR;
+			TCCR0B = SYSTICK_SLOW_CS;
+		} else {
+			SYSTICK_TIMER_COUNTER <<= 1;
+			OCR0B <<= 1;
+			SYSTICK_TIMER_OCR = SYSTICK_OCR_CONST;
+			TCCR0B = SYSTICK_FAST_CS;
+		}
+	}
+	clock_slow = slow;
+}
+#endif
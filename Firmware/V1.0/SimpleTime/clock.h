@@ -0,0 +1,20 @@
+/*
+ * clock.h
+ *
+ * Created: 19.10.2026 17:21:36
+ *  CPU clock scaling
+ */
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdio.h>
+
+/************************************************************************/
+/* FUNCTIONS                                                            */
+/************************************************************************/
+#if (CLOCK_SCALE_ENABLE)
+extern	uint8_t	clock_slow;												// CPU runs at F_CPU / CLOCK_SLOW_FACTOR
+extern	void clock_Set(uint8_t slow);									// Switch CPU clock, timers keep time base
+#endif
+
+#endif
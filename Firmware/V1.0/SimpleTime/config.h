@@ -23,10 +23,34 @@
 #define SYSTICK_TIMER_INIT()            { TCCR0A=1<<WGM01; TCCR0B=1<<CS01|1<<CS00; OCR0A=SYSTICK_OCR_CONST; /*SYSTICK_TIMER_COUNTER=0;*/ }
 #define SYSTICK_INTERRUPT_ENABLE()      { TIMSK |= 1<<OCIE0A; }
 #define SYSTICK_INTERRUPT_DISABLE()     { TIMSK &= ~(1<<OCIE0A); }
+#define SYSTICK_PENDING					( TIFR & (1<<OCF0A) )
+
+//------------------------------ Optional features
+// Every feature switch defaults to 0. "cost" after a switch is flash/RAM
+// bytes it adds in Host 'make size' over the all-off build, an x86 -Os
+// proxy, not a measured AVR size. Host sim builds turn features on by -D.
 
 //------------------------------ RTOS configuration
-#define RTOS_TASK_QUEUE_SIZE            5
-#define RTOS_TIMER_TASK_QUEUE_SIZE      5
+#ifndef RTOS_TASK_QUEUE_SIZE
+	#define RTOS_TASK_QUEUE_SIZE        5
+#endif
+// Timer queue must hold every task ever passed to RTOS_SetTimerTask at
+// once (3 AUTO_* loops, buzzerStep and waiting AUTO_EepromSave), a
+// dropped re-arm stops its loop
+#ifndef RTOS_TIMER_TASK_QUEUE_SIZE
+	#define RTOS_TIMER_TASK_QUEUE_SIZE  5
+#endif
+#define RTOS_PROFILE_ENABLE				0					// Task runtime/lateness and ISR duration stats
+#define RTOS_PROFILE_SLOTS				4					// Tasks tracked, first dispatched first served
+#define RTOS_LOAD_ENABLE				0					// Idle time of scheduler passes, see RTOS_IdleTake
+#ifndef RTOS_WDT_ENABLE
+	#define RTOS_WDT_ENABLE				0					// Watchdog fed by scheduler while deadlines hold, cost 459/12
+#endif
+#define RTOS_WDT_TIMEOUT				WDTO_250MS			// Reset this long after a hang or deadline miss
+#define RTOS_DEADLINES_COUNT			3					// Periodic tasks with deadline budget, see main.c
+#ifndef RTOS_DROPS_ENABLE
+	#define RTOS_DROPS_ENABLE			DIAG_ENABLE			// Queue full counters for diagnostics page, cost 48/2
+#endif
 
 //------------------------------ Timer configuration
 #define TIMER_TICK_TIME_MS				1000UL
@@ -36,19 +60,68 @@
 #define TIMER_TICK_OCR_REG				OCR1A
 #define TIMER_TICK_INIT()				{ TCCR1A=0; TCCR1B=0; TIMER_TICK_OCR_REG=TIMER_TICK_OCR_CONST; }
 #define TIMER_TICK_START()				{ TIMER_TICK_COUNTER_REG=0; TCCR1B=1<<WGM12|1<<CS12|1<<CS10; }
-#define TIMER_TICK_STOP()				{ TCCR1B &= ~(1<<WGM12|1<<CS12|1<<CS10); }
+#define TIMER_TICK_STOP()				{ TCCR1B &= ~(1<<WGM12|1<<CS12|1<<CS11|1<<CS10); }
 #define TIMER_TICK_TOGGLE()				{ TCCR1B ^= (1<<WGM12|1<<CS12|1<<CS10); }
 #define TIMER_TICK_CHECK				( TCCR1B & (1<<WGM12|1<<CS12|1<<CS10) )
 #define TIMER_TICK_INTERRUPT_ENABLE()	{ TIMER_TICK_COUNTER_REG=0; TIMSK |= 1<<OCIE1A; }
 #define TIMER_TICK_INTERRUPT_DISABLE()	{ TIMSK &= ~(1<<OCIE1A); }
 #define TIMER_TICK_INTERRUPT_TOGGLE()   { TIMSK ^= (1<<OCIE1A); }
 #define TIMER_TICK_CHECK_INTERRUPT		(TIMSK & (1<<OCIE1A))
+#define TIMER_TICK_PENDING				( TIFR & (1<<OCF1A) )
+#ifndef TIMER_TICK_TRIM_ENABLE
+	#define TIMER_TICK_TRIM_ENABLE		0					// Fractional tick period, second is exact on average, cost 33/1
+#endif
+#define TIMER_TICK_TRIM_PPM				0					// Oscillator error to cancel, ppm fast against a reference clock
+#define TIMER_TICK_PERIOD_256			((long)(F_CPU / (TIMER_TICK_PRESCALER / 256)) + (long)(F_CPU / (TIMER_TICK_PRESCALER / 256) / 1000) * TIMER_TICK_TRIM_PPM / 1000)	// Counts per second, 1/256
+
+
+//------------------------------ Diagnostics configuration
+#define DIAG_ENABLE						0					// Hidden diagnostics pages and stack monitor
+#define DIAG_STACK_CANARY				0xC5				// Pattern painted over free RAM at startup
+#define DIAG_BENCH_ENABLE				0					// Benchmark pages, button held at power up opens them
+
+
+//------------------------------ Trace UART configuration
+// Transmit-only software UART, 8N2. Bytes are sent from RTOS idle only
+// when no timer compare is due within one byte time, so ISRs never wait
+#define TRACE_ENABLE					0					// Stream binary event trace on PD6
+#define TRACE_BAUD						115200UL			// Real rate is F_CPU / (10 + 3 * TRACE_BIT_DELAY)
+#define TRACE_BUFFER_SIZE				16					// Ring buffer bytes, power of two
+#define TRACE_BIT_DELAY					(((F_CPU / TRACE_BAUD) - 10 + 1) / 3)
+#define TRACE_BYTE_CYCLES				(11 * (10 + 3 * TRACE_BIT_DELAY) + 20)
+#define TRACE_DDR						DDRD
+#define TRACE_PORT						PORTD
+#define TRACE_BIT						6
+#define TRACE_INIT()					{ TRACE_PORT |= 1<<TRACE_BIT; TRACE_DDR |= 1<<TRACE_BIT; }
+
+//------------------------------ CPU clock scaling
+// While countdown runs untouched the CPU drops to F_CPU / 16 through CLKPR.
+// Both timers change prescaler with it and keep their time base: systick
+// stays 126 counts of 8us, countdown timer stays 7813 counts of 128us.
+// Timer start/stop macros are valid at full clock only, see clock.c
+#ifndef CLOCK_SCALE_ENABLE
+	#define CLOCK_SCALE_ENABLE			0					// Not with TRACE_ENABLE or RTOS_PROFILE_ENABLE, cost 432/4
+#endif
+#define CLOCK_SLOW_DIV					clock_div_16		// 500 kHz
+#define CLOCK_SLOW_FACTOR				16
+#define CLOCK_SLOW_IDLE_MS				5000				// No input this long before slowing down
+#define SYSTICK_SLOW_PRESCALER			8L
+#define SYSTICK_SLOW_CS					(1<<CS01)
+#define SYSTICK_SLOW_OCR				((SYSTICK_OCR_CONST + 1) * SYSTICK_PRESCALER / (SYSTICK_SLOW_PRESCALER * CLOCK_SLOW_FACTOR) - 1)
+#define SYSTICK_FAST_CS					(1<<CS01|1<<CS00)
+#define TIMER_TICK_SLOW_CS				(1<<CS11|1<<CS10)	// 1024 / CLOCK_SLOW_FACTOR
+#define TIMER_TICK_FAST_CS				(1<<CS12|1<<CS10)
 
 
 //------------------------------ Display configuration
 #define HD44780_4bit_MODE				1					// 0 - 8bit mode, 1 - 4bit mode
 #define HD44780_IO_DATA_SHIFT			4					// Shift to the left by port pins in 4bit mode
-#define HD44780_BL_CTRL					0					// Use for control back light
+#ifndef HD44780_BL_CTRL
+	#define HD44780_BL_CTRL				0					// Use for control back light, cost 131/2
+#endif
+#ifndef HD44780_BL_PWM
+	#define HD44780_BL_PWM				0					// Brightness by software PWM on systick timer compare B, cost 104/0 more
+#endif
 #define HD44780_WAIT_BUSY_FLAG			0					// Check LCD busy flag
 // Parallel ports settings
 #define HD44780_IO_DATA_DDR				DDRB
@@ -71,8 +144,18 @@
 	#define HD44780_IO_PIN_BL_DDR		DDRB
 	#define HD44780_IO_PIN_BL_PORT		PORTB
 	#define HD44780_IO_PIN_BL_MASK		(1<<0)				// 0bit of port
+	#define HD44780_BL_ON()				{ HD44780_IO_PIN_BL_PORT |= HD44780_IO_PIN_BL_MASK; }
+	#define HD44780_BL_OFF()			{ HD44780_IO_PIN_BL_PORT &= ~HD44780_IO_PIN_BL_MASK; }
+	// PWM period starts in systick ISR, duty ends at compare B. OC0B
+	// buzzer tone toggles once per period at any OCR0B, so both coexist
+	#define HD44780_BL_PWM_ACTIVE		(TIMSK & (1<<OCIE0B))
 #endif
 
+//------------------------------ Back light dimming
+#define BACKLIGHT_FULL					255
+#define BACKLIGHT_DIM					24					// Brightness after idle, 0 - off
+#define BACKLIGHT_DIM_IDLE_MS			20000				// No input this long before dimming, up to 65535
+
 
 
 //------------------------------ Encoder configuration
@@ -89,6 +172,19 @@
 #define BTN_INIT()						{ BTN_DDR &= ~(BTN_MASK); }
 #define BTN_PRESSED						(!(BTN_PIN & BTN_MASK))
 
+//------------------------------ Input sampler, encoder and button share one port
+#define INPUT_PIN						PIND
+#define INPUT_MASK						(ENC_MASK|BTN_MASK)
+#define INPUT_STATE						(INPUT_PIN & INPUT_MASK)
+#define INPUT_SCAN_MS					2					// Sample period; button flips on 4th, encoder on 2nd equal sample
+#define INPUT_LONG_PRESS_MS				600					// Button hold time for long press
+
+//------------------------------ Encoder acceleration
+#ifndef ENC_ACCEL_ENABLE
+	#define ENC_ACCEL_ENABLE			0					// Faster spin gives bigger steps in setup modes, see main.c, cost 115/2
+#endif
+#define ENC_ACCEL_CARRY					0					// Step past field range carries into next field
+
 
 //------------------------------ IO relay configuration
 #define RELAY_DDR						DDRD
@@ -99,6 +195,59 @@
 #define RELAY_TOGGLE()					{ RELAY_PORT ^= RELAY_MASK; }
 #define RELAY_INIT()					{ RELAY_DDR |= RELAY_MASK; RELAY_OFF(); }
 
+//------------------------------ Countdown channels
+// All channels count on the one TIMER_TICK interrupt, channel 0 drives
+// the relay. Spare outputs are shared: PD6 with TRACE_ENABLE, PB0 with
+// HD44780_BL_CTRL, a channel takes the pin only with its feature off.
+// More channels, programs, stopwatch and schedule share one tick count
+// and expiry list, about 637/12 of each of their costs, paid once
+#ifndef CHANNELS_COUNT
+	#define CHANNELS_COUNT				1					// 1..3, cost 714/22 for second, 39/10 for third
+#endif
+#define CHANNEL1_DDR					DDRD
+#define CHANNEL1_PORT					PORTD
+#define CHANNEL1_MASK					(1<<6)
+#define CHANNEL1_INIT()					{ CHANNEL1_DDR |= CHANNEL1_MASK; CHANNEL1_PORT &= ~CHANNEL1_MASK; }
+#define CHANNEL2_DDR					DDRB
+#define CHANNEL2_PORT					PORTB
+#define CHANNEL2_MASK					(1<<0)
+#define CHANNEL2_INIT()					{ CHANNEL2_DDR |= CHANNEL2_MASK; CHANNEL2_PORT &= ~CHANNEL2_MASK; }
+
+//------------------------------ Cycle programs
+// A channel with a program selected runs its steps instead of a single
+// countdown. Step is 4 bytes: opcode, output state of the channel itself
+// or loop target, seconds or loop passes. Tick ISR moves to the next
+// step, built-in programs are in main.c, EEPROM ones in .eep image
+#ifndef PROG_ENABLE
+	#define PROG_ENABLE					0					// Cost 1372/16 and 65 B EEPROM
+#endif
+#define PROG_EEPROM_STEPS				16					// 4 bytes of EEPROM each
+#define PROG_RUN_LIMIT					8					// Untimed steps per tick before program is stopped
+#define EEPROM_WRITE_TICK_CLOCKS		(3400UL * (F_CPU / 1000000UL) / TIMER_TICK_PRESCALER + 1)	// 3.4ms byte write
+
+//------------------------------ Stopwatch
+// Counts up on the countdown timer: ticks give seconds, the timer counter
+// gives 128us steps in between. Page follows the channels, MM:SS.cc,
+// minutes wrap at 100
+#ifndef STOPWATCH_ENABLE
+	#define STOPWATCH_ENABLE			0					// Cost 1334/20
+#endif
+#define STOPWATCH_REDRAW_MS				10					// Hundredths redraw period while running
+
+//------------------------------ Daily schedule
+// Time of day clock on the 1 Hz tick, its page follows the stopwatch and
+// runs from the moment it is set there. Entries in .eep image switch a
+// channel output on or off at a minute of chosen weekdays, a countdown or
+// program running on it is paused first. Tick compares the clock with the
+// planned event only, entries are scanned after each event. Weekday is
+// set in program mode. Set clock keeps the tick running, so a countdown
+// started later joins its phase, rounded to the nearest second. Needs
+// TIMER_TICK_TRIM_ENABLE, the plain tick is 64 ppm slow
+#ifndef SCHED_ENABLE
+	#define SCHED_ENABLE				0					// Needs PROG_ENABLE and TIMER_TICK_TRIM_ENABLE, cost 990/12 more and 32 B EEPROM
+#endif
+#define SCHED_ENTRIES					8					// 4 bytes of EEPROM each
+
 //------------------------------ IO system LED configuration
 #define TICK_LED_DDR					DDRD
 #define TICK_LED_PORT					PORTD
@@ -110,10 +259,26 @@
 
 
 //------------------------------ IO buzzer configuration
+// Alarm is toggled by AUTO_ToggleOutputs every 500ms by default. With
+// patterns, beeps are sequenced from a PROGMEM table and buzzer pin PD5
+// is OC0B. Tone is generated by SYSTICK timer hardware: OC0B toggles on
+// every compare match, so tone is SYSTICK frequency / 2.
+// Board has an active buzzer, driven by steady level. Set 1 only after
+// replacing it by a passive piezo, active one must not get square wave
+#ifndef BUZZER_PATTERN_ENABLE
+	#define BUZZER_PATTERN_ENABLE		0					// Beep patterns from table, cost 138/7
+#endif
+#define BUZZER_PASSIVE					0					// Needs BUZZER_PATTERN_ENABLE
 #define BUZZER_DDR						DDRD
 #define BUZZER_PORT						PORTD
 #define BUZZER_MASK						(1<<5)
 #define BUZZER_TOGGLE()					{ BUZZER_PORT ^= BUZZER_MASK; }
 #define BUZZER_ON()						{ BUZZER_PORT |= BUZZER_MASK; }
-#define BUZZER_OFF()					{ BUZZER_PORT &= ~BUZZER_MASK; }
-#define BUZZER_INIT()					{ BUZZER_DDR |= BUZZER_MASK; }
\ No newline at end of file
+#if (BUZZER_PATTERN_ENABLE)
+	#define BUZZER_OFF()				{ TCCR0A &= ~(1<<COM0B1|1<<COM0B0); BUZZER_PORT &= ~BUZZER_MASK; }
+	#define BUZZER_TONE_ON()			{ TCCR0A |= 1<<COM0B0; }
+	#define BUZZER_INIT()				{ BUZZER_DDR |= BUZZER_MASK; OCR0B=0; }
+#else
+	#define BUZZER_OFF()				{ BUZZER_PORT &= ~BUZZER_MASK; }
+	#define BUZZER_INIT()				{ BUZZER_DDR |= BUZZER_MASK; }
+#endif
\ No newline at end of file
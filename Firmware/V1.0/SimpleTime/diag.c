@@ -0,0 +1,282 @@
+/*
+ * diag.c
+ *
+ * Created: 19.10.2026 11:02:05
+ *  Diagnostics pages and stack monitor
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+#include "drvHD44780.h"
+#include "rtos.h"
+#include "reset.h"
+#include "strings.h"
+#include "utils.h"
+#include "diag.h"
+
+#if (DIAG_ENABLE)
+#if (DIAG_BENCH_ENABLE && !RTOS_LOAD_ENABLE)
+	#error "Scheduler idle page needs RTOS_LOAD_ENABLE"
+#endif
+#if (!RTOS_DROPS_ENABLE)
+	#error "Queue page needs RTOS_DROPS_ENABLE"
+#endif
+
+#define DIAG_LCD_BYTES					8								// Bytes timed per LCD throughput sample
+#define DIAG_TICK_COUNTS				(F_CPU / SYSTICK_PRESCALER)		// 8us counts in 1 Hz tick
+#define DIAG_TICK_ERR_MAX				4095							// Counts off, longer tick was not back to back
+
+#define DIAG_STR(x)						#x
+#define DIAG_XSTR(x)					DIAG_STR(x)						// Macro value as asm text
+
+/************************************************************************/
+/* VARS                                                                 */
+/************************************************************************/
+extern	uint8_t		_end;							// End of .bss, set by linker
+extern	uint8_t		__stack;						// Stack top (RAMEND), set by linker
+
+//-> Page titles indexed by DIAG_PAGE_ENUM
+const	uint8_t		diag_titles[DIAG_PAGES_COUNT] PROGMEM = {
+	[DIAG_PAGE_STACK]	= STR_DIAG_STACK,
+	[DIAG_PAGE_QUEUE]	= STR_DIAG_QUEUE,
+#if (RTOS_WDT_ENABLE)
+	[DIAG_PAGE_RESET]	= STR_DIAG_RESET,
+#endif
+#if (RTOS_PROFILE_ENABLE)
+	[DIAG_PAGE_ISR]		= STR_DIAG_ISR,
+	[DIAG_PAGE_TASK ... DIAG_PAGE_TASK_LAST] = STR_DIAG_TASK,
+#endif
+#if (DIAG_BENCH_ENABLE)
+	[DIAG_PAGE_LCD]		= STR_DIAG_LCD,
+	[DIAG_PAGE_JITTER]	= STR_DIAG_JITTER,
+	[DIAG_PAGE_TICK]	= STR_DIAG_TICK,
+	[DIAG_PAGE_IDLE]	= STR_DIAG_IDLE,
+	[DIAG_PAGE_ENCODER]	= STR_DIAG_ENCODER,
+#endif
+};
+
+uint8_t				diag_page;						// Current page
+
+#if (DIAG_BENCH_ENABLE)
+struct	DIAG_BENCH_STRUCT	diag_bench;				// Benchmark samples
+#endif
+
+
+/************************************************************************/
+/* FUNCTIONS                                                            */
+/************************************************************************/
+//------------------------------ Paint free RAM before .bss/.data init and SP setup
+// Runs before the zero register and SP are set up, so basic asm only
+void diag_StackPaint(void) __attribute__((naked, used, section(".init1")));
+void diag_StackPaint(void)
+{
+	__asm volatile (
+		"ldi	r30, lo8(_end)				\n"
+		"ldi	r31, hi8(_end)				\n"
+		"ldi	r24, " DIAG_XSTR(DIAG_STACK_CANARY) "	\n"
+		"1:	st	Z+, r24					\n"
+		"cpi	r30, lo8(__stack + 1)		\n"
+		"ldi	r25, hi8(__stack + 1)		\n"
+		"cpc	r31, r25					\n"
+		"brne	1b							\n"
+	);
+}
+
+//------------------------------ Count untouched stack bytes, the deepest use since reset
+uint8_t diag_StackFree(void)
+{
+	uint8_t *p = &_end;
+
+	while(p <= &__stack && *p == DIAG_STACK_CANARY) {
+		p++;
+	}
+	return p - &_end;
+}
+
+#if (DIAG_BENCH_ENABLE)
+//------------------------------ Counter ticks from stamp to now, stamp moves to now, interrupts are off
+static uint32_t diag_Since(struct DIAG_STAMP_STRUCT *from)
+{
+	uint16_t systicks = diag_bench.systicks;
+	uint8_t counter = SYSTICK_TIMER_COUNTER;
+	uint32_t span;
+
+	// Counter was cleared by compare match, systick ISR is held off
+	if(SYSTICK_PENDING) {
+		systicks++;
+		counter = SYSTICK_TIMER_COUNTER;
+	}
+	span = (uint32_t)(uint16_t)(systicks - from->systicks) * (SYSTICK_OCR_CONST + 1) + counter - from->counter;
+	from->systicks = systicks;
+	from->counter = counter;
+	return span;
+}
+
+//------------------------------ 1 Hz tick ISR hook, tick length in systick counter ticks
+void diag_BenchTick(void)
+{
+	diag_bench.tick_counts = diag_Since(&diag_bench.tick_at);
+}
+
+//------------------------------ Four hex digits
+static void diag_PutWord(uint16_t value)
+{
+	char buffer[3];
+
+	hd44780_Puts(hex_to_ascii(value >> 8, buffer));
+	hd44780_Puts(hex_to_ascii(value, buffer));
+}
+#endif
+
+//------------------------------ Draw page title
+static void diag_DrawPage(void)
+{
+	hd44780_Clear();
+	hd44780_PutsF(ST_STR(pgm_read_byte(diag_titles + diag_page)));
+#if (DIAG_BENCH_ENABLE)
+	// Latency and idle share are taken from the moment page is shown
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		diag_bench.latency_min = 0xFF;
+		diag_bench.latency_max = 0;
+		diag_Since(&diag_bench.idle_at);
+	}
+	RTOS_IdleTake();
+#endif
+}
+
+//------------------------------ Show diagnostics page
+void diag_Open(uint8_t page)
+{
+	diag_page = page;
+	diag_DrawPage();
+}
+
+//------------------------------ Show next diagnostics page
+void diag_NextPage(void)
+{
+	if(++diag_page >= DIAG_PAGES_COUNT) diag_page = 0;
+	diag_DrawPage();
+}
+
+#if (RTOS_PROFILE_ENABLE)
+//------------------------------ Task address, max and average runtime, max lateness, hex
+static void diag_DrawTask(const struct RTOS_PROFILE_STRUCT *p)
+{
+	char buffer[3];
+	uint16_t address = (uint16_t)(uintptr_t)p->task;
+
+	// Word address as in .map file, free slot shows all zeros
+	hd44780_Puts(hex_to_ascii(address >> 8, buffer));
+	hd44780_Puts(hex_to_ascii(address, buffer));
+	hd44780_GoToXY(1, 5);
+	hd44780_Puts(hex_to_ascii(p->run_max, buffer));
+	hd44780_GoToXY(1, 9);
+	hd44780_Puts(hex_to_ascii(p->run_avg >> 3, buffer));
+	hd44780_GoToXY(1, 13);
+	hd44780_Puts(hex_to_ascii(p->late_max, buffer));
+}
+#endif
+
+//------------------------------ Refresh values on current page
+void diag_Update(void)
+{
+	char buffer[4];
+#if (DIAG_BENCH_ENABLE)
+	struct DIAG_STAMP_STRUCT at;
+	uint32_t span;
+	int32_t error;
+	uint16_t idle;
+	uint8_t i;
+#endif
+
+	hd44780_GoToXY(1, 0);
+	switch(diag_page) {
+		// Free stack bytes and total stack size, hex
+		case DIAG_PAGE_STACK:
+			hd44780_Puts(hex_to_ascii(diag_StackFree(), buffer));
+			hd44780_SendData('/');
+			hd44780_Puts(hex_to_ascii(&__stack - &_end + 1, buffer));
+			break;
+		// Run queue and timer queue full counters, hex
+		case DIAG_PAGE_QUEUE:
+			hd44780_Puts(hex_to_ascii(RTOS_TaskDrops, buffer));
+			hd44780_SendData('/');
+			hd44780_Puts(hex_to_ascii(RTOS_TimerDrops, buffer));
+			break;
+#if (RTOS_WDT_ENABLE)
+		// MCUSR of last reset, watchdog resets, deadline misses, hex
+		case DIAG_PAGE_RESET:
+			hd44780_Puts(hex_to_ascii(reset_record.cause, buffer));
+			hd44780_SendData('/');
+			hd44780_Puts(hex_to_ascii(reset_record.wdt_resets, buffer));
+			hd44780_SendData('/');
+			hd44780_Puts(hex_to_ascii(reset_record.overruns, buffer));
+			break;
+#endif
+#if (RTOS_PROFILE_ENABLE)
+		// Max duration of systick and countdown ISR, counter ticks
+		case DIAG_PAGE_ISR:
+			hd44780_Puts(hex_to_ascii(RTOS_ProfileIsr[RTOS_PROFILE_ISR_SYSTICK], buffer));
+			hd44780_SendData('/');
+			hd44780_Puts(hex_to_ascii(RTOS_ProfileIsr[RTOS_PROFILE_ISR_TICK], buffer));
+			break;
+		// Stats of one profiler slot
+		case DIAG_PAGE_TASK ... DIAG_PAGE_TASK_LAST:
+			diag_DrawTask(&RTOS_Profile[diag_page - DIAG_PAGE_TASK]);
+			break;
+#endif
+#if (DIAG_BENCH_ENABLE)
+		// Bytes per second sent with current bus timing, hex. Blanks after value are timed
+		// with interrupts held, so only LCD waits are counted
+		case DIAG_PAGE_LCD:
+			hd44780_GoToXY(1, 8);
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+				diag_Since(&at);
+				for(i = 0; i < DIAG_LCD_BYTES; i++) hd44780_SendData(' ');
+				span = diag_Since(&at);
+			}
+			hd44780_GoToXY(1, 0);
+			diag_PutWord(span ? DIAG_LCD_BYTES * DIAG_TICK_COUNTS / span : 0xFFFF);
+			break;
+		// Systick ISR entry latency min/max, jitter is their difference, counter ticks
+		case DIAG_PAGE_JITTER:
+			hd44780_Puts(hex_to_ascii(diag_bench.latency_min, buffer));
+			hd44780_SendData('/');
+			hd44780_Puts(hex_to_ascii(diag_bench.latency_max, buffer));
+			break;
+		// Last 1 Hz tick against systick, signed ppm in hex, dashes while tick is stopped
+		case DIAG_PAGE_TICK:
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+				span = diag_bench.tick_counts;
+			}
+			error = span - DIAG_TICK_COUNTS;
+			if(!TIMER_TICK_CHECK || error > DIAG_TICK_ERR_MAX || error < -DIAG_TICK_ERR_MAX) {
+				for(i = 0; i < 5; i++) hd44780_SendData('-');
+				break;
+			}
+			hd44780_SendData(error < 0 ? '-' : '+');
+			diag_PutWord((error < 0 ? -error : error) * (1000000UL / DIAG_TICK_COUNTS));
+			break;
+		// Share of time scheduler found no task since last refresh, decimal percent
+		case DIAG_PAGE_IDLE:
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+				span = diag_Since(&diag_bench.idle_at);
+			}
+			idle = RTOS_IdleTake();
+			if(idle > span) idle = span;
+			hd44780_Puts(utoa_cycle_sub(span ? (uint32_t)idle * 100 / span : 0, buffer));
+			hd44780_SendData('%');
+			hd44780_SendData(' ');
+			break;
+		// Encoder samples with both phases flipped since power up, hex
+		case DIAG_PAGE_ENCODER:
+			hd44780_Puts(hex_to_ascii(diag_bench.enc_errors, buffer));
+			break;
+#endif
+	}
+}
+#endif
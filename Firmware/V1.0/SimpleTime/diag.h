@@ -0,0 +1,79 @@
+/*
+ * diag.h
+ *
+ * Created: 19.10.2026 11:02:17
+ *  Diagnostics pages and stack monitor
+ */
+#ifndef DIAG_H
+#define DIAG_H
+
+#include <stdio.h>
+
+enum DIAG_PAGE_ENUM
+{
+	DIAG_PAGE_STACK,			// Stack high-water mark
+	DIAG_PAGE_QUEUE,			// Requests dropped by full RTOS queues
+#if (RTOS_WDT_ENABLE)
+	DIAG_PAGE_RESET,			// Last reset cause, watchdog resets and deadline misses
+#endif
+#if (RTOS_PROFILE_ENABLE)
+	DIAG_PAGE_ISR,				// Max ISR duration of both timers
+	DIAG_PAGE_TASK,				// One page per profiler slot
+	DIAG_PAGE_TASK_LAST = DIAG_PAGE_TASK + RTOS_PROFILE_SLOTS - 1,
+#endif
+#if (DIAG_BENCH_ENABLE)
+	DIAG_PAGE_LCD,				// LCD bus throughput
+	DIAG_PAGE_JITTER,			// Systick ISR entry latency min/max
+	DIAG_PAGE_TICK,				// 1 Hz tick length against systick
+	DIAG_PAGE_IDLE,				// Scheduler idle share
+	DIAG_PAGE_ENCODER,			// Invalid encoder transitions
+#endif
+	DIAG_PAGES_COUNT
+};
+
+#if (DIAG_BENCH_ENABLE)
+struct DIAG_STAMP_STRUCT
+{
+	uint16_t		systicks;	// Systick count
+	uint8_t			counter;	// Systick counter, 8us
+};
+
+struct DIAG_BENCH_STRUCT
+{
+	volatile uint16_t systicks;	// Systick ISR count, wraps
+	uint8_t			latency_min,	// Systick ISR entry latency since page was shown, 8us
+					latency_max;
+	uint8_t			enc_errors;	// Encoder samples with both phases flipped, saturates
+	uint32_t		tick_counts;	// Last 1 Hz tick length, 8us
+	struct DIAG_STAMP_STRUCT tick_at;	// Last 1 Hz tick
+	struct DIAG_STAMP_STRUCT idle_at;	// Idle share window start
+};
+
+extern	struct	DIAG_BENCH_STRUCT	diag_bench;
+
+// First statement of systick ISR, counter restarted from zero on compare match
+#define DIAG_BENCH_SYSTICK()			{ uint8_t c = SYSTICK_TIMER_COUNTER; \
+										  if(c < diag_bench.latency_min) diag_bench.latency_min = c; \
+										  if(c > diag_bench.latency_max) diag_bench.latency_max = c; \
+										  diag_bench.systicks++; }
+#define DIAG_BENCH_TICK()				diag_BenchTick()
+// Both phases changed on one sample, step direction is lost
+#define DIAG_BENCH_ENCODER(changed)		{ if(((changed) & ENC_MASK) == ENC_MASK && diag_bench.enc_errors != 0xFF) diag_bench.enc_errors++; }
+#else
+#define DIAG_BENCH_SYSTICK()
+#define DIAG_BENCH_TICK()
+#define DIAG_BENCH_ENCODER(changed)
+#endif
+
+/************************************************************************/
+/* FUNCTIONS                                                            */
+/************************************************************************/
+extern	uint8_t diag_StackFree(void);									// Untouched stack bytes since reset
+extern	void diag_Open(uint8_t page);								// Show diagnostics page
+extern	void diag_NextPage(void);										// Show next diagnostics page
+extern	void diag_Update(void);											// Refresh values on current page
+#if (DIAG_BENCH_ENABLE)
+extern	void diag_BenchTick(void);										// 1 Hz tick ISR hook
+#endif
+
+#endif
@@ -23,10 +23,6 @@
 #define HD44780_RW_LOW()				{HD44780_IO_PIN_RW_PORT &= ~(HD44780_IO_PIN_RW_MASK);}
 #define HD44780_E_HIGH()				{HD44780_IO_PIN_E_PORT |= HD44780_IO_PIN_E_MASK;}
 #define HD44780_E_LOW()					{HD44780_IO_PIN_E_PORT &= ~(HD44780_IO_PIN_E_MASK);}
-#if (HD44780_BL_CTRL)
-	#define HD44780_BL_HIGH()			HD44780_IO_PIN_BL_PORT |= HD44780_IO_PIN_BL_MASK
-	#define HD44780_BL_LOW()			HD44780_IO_PIN_BL_PORT &= ~HD44780_IO_PIN_BL_MASK
-#endif
 #define HD44780_SetDATA_4bit(val)		{HD44780_IO_DATA_PORT &= ~(0xF << HD44780_IO_DATA_SHIFT); HD44780_IO_DATA_PORT |= ((val) << HD44780_IO_DATA_SHIFT);}
 #define HD44780_SetDATA_8bit(val)		{HD44780_IO_DATA_PORT = val;}
 #define HD44780_GetDATA_4bit()			((HD44780_IO_DATA_PIN >> HD44780_IO_DATA_SHIFT) & 0x0F)
@@ -220,6 +216,28 @@ inline void hd44780_Init(void)
 	hd44780_SendCmd(HD44780_OPT_ADDRESS_INCREMENT | HD44780_OPT_LINE_SHIFT_DISABLE);
 }
 
+#if (HD44780_BL_CTRL)
+//------------------------------ Back light brightness, 0 - off, 255 - full
+void hd44780_Backlight(uint8_t level)
+{
+#if (HD44780_BL_PWM)
+	// Partial brightness: duty in counts of current systick period
+	if(level && level != 0xFF) {
+		OCR0B = ((uint16_t)level * (SYSTICK_TIMER_OCR + 1)) >> 8;
+		TIMSK |= 1<<OCIE0B;
+		return;
+	}
+	// Full and zero brightness need no interrupts
+	TIMSK &= ~(1<<OCIE0B);
+#endif
+	if(level) {
+		HD44780_BL_ON();
+	} else {
+		HD44780_BL_OFF();
+	}
+}
+#endif
+
 //------------------------------ Set cursor to position of X,Y
 void hd44780_GoToXY(uint8_t Row, uint8_t Col)
 {
@@ -75,5 +75,6 @@ extern  void hd44780_PutsF(const char * str);							// Send string from flash to
 extern  void hd44780_CreateCharacter(char code, char * pattern);		// The function is create new char from pattern
 extern	void hd44780_CreateCharacterF(char code, const char * pattern);	// The function is create new char from pattern from flash
 extern	void hd44780_Printf(const char * args, ...);					// Formatted print from current position
+extern	void hd44780_Backlight(uint8_t level);							// Back light brightness, 0 - off, 255 - full, HD44780_BL_CTRL
 
 #endif
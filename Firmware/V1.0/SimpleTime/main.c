@@ -9,11 +9,47 @@
 #include <avr/interrupt.h>
 #include <avr/pgmspace.h>
 #include <avr/eeprom.h>
+#include <util/atomic.h>
 
 #include "config.h"
 #include "rtos.h"
 #include "drvHD44780.h"
 #include "utils.h"
+#include "strings.h"
+#include "diag.h"
+#include "trace.h"
+#include "reset.h"
+#include "clock.h"
+
+#if (CHANNELS_COUNT > 1 && TRACE_ENABLE) || (CHANNELS_COUNT > 2 && HD44780_BL_CTRL)
+	#error "Channel output pin is taken by trace UART or back light, reduce CHANNELS_COUNT"
+#endif
+#if (SCHED_ENABLE && !PROG_ENABLE)
+	#error "Clock weekday is set in program setup mode, enable PROG_ENABLE"
+#endif
+#if (SCHED_ENABLE && !TIMER_TICK_TRIM_ENABLE)
+	#error "Untrimmed tick is 64 ppm slow, ~39 s a week on the clock, enable TIMER_TICK_TRIM_ENABLE"
+#endif
+#if (BUZZER_PASSIVE && !BUZZER_PATTERN_ENABLE)
+	#error "Passive buzzer needs OC0B tone, enable BUZZER_PATTERN_ENABLE"
+#endif
+// Channels share one tick count and an expiry list, otherwise the one
+// channel counts its h:m:s down in tick ISR as the original timer did
+#define TIMER_SHARED					(CHANNELS_COUNT > 1 || PROG_ENABLE || STOPWATCH_ENABLE || SCHED_ENABLE)
+#define CHANNEL_NONE					0xFF	// End of expiry list
+#define PROG_PC_EEPROM					0x80	// Program counter points into EEPROM steps
+#define PROG_PC_IDLE					0xFF	// No program started on channel
+#define STOPWATCH						CHANNELS_COUNT	// Stopwatch page and running bit follow channels
+#define SCHED_PAGE						(CHANNELS_COUNT + STOPWATCH_ENABLE)	// Clock page follows stopwatch
+#define UI_PAGES						(SCHED_PAGE + SCHED_ENABLE)
+#define EEPROM_SAVE_BYTES				(3 + PROG_ENABLE)	// Timer value and program number
+#define BENCH_RUNNING					7		// Running bit keeping 1 Hz tick on for benchmark pages
+#define SCHED_RUNNING					6		// Running bit keeping 1 Hz tick on for set clock
+#define TIMER_BLINK_BITS				(uint8_t)~(1 << SCHED_RUNNING)	// Running bits blinking tick LED
+#define SCHED_DAY_SECONDS				86400UL
+#define SCHED_WEEK_SECONDS				(7 * SCHED_DAY_SECONDS)
+#define SCHED_NONE						0xFFFFFFFFUL	// No event planned
+#define SCHED_START						0x80	// Entry switches channel output on, off otherwise
 
 
 /************************************************************************/
@@ -24,14 +60,20 @@ enum MODE_ENUM
 	MODE_NORMAL,				// Default normal working mode
 	MODE_SET_TIMER_SECONDS,		// Setup seconds
 	MODE_SET_TIMER_MINUTES,		// Setup minutes
-	MODE_SET_TIMER_HOURS		// Setup hours
+	MODE_SET_TIMER_HOURS,		// Setup hours
+#if (PROG_ENABLE)
+	MODE_SET_PROGRAM,			// Setup cycle program
+#endif
+#if (DIAG_ENABLE)
+	MODE_DIAG					// Hidden diagnostics pages
+#endif
 };
 
 enum BUTTON_STATE_ENUM
 {
 	BUTTON_STATE_UP,		// Button not pressed
 	BUTTON_STATE_DN,		// Button pressed short
-	BUTTON_STATE_AL			// Button pressed
+	BUTTON_STATE_AL			// Button held for long press
 };
 
 enum BUTTON_EVENTS_ENUM
@@ -41,37 +83,349 @@ enum BUTTON_EVENTS_ENUM
 	BUTTON_EVENT_LONG_PRESS     // Long press event
 };
 
+struct INPUT_STRUCT
+{
+	uint8_t			state,			// Debounced input pins
+					cnt0,			// Vertical counters, bit 0 of each pin counter
+					cnt1;			// Vertical counters, bit 1 of each pin counter
+#if (CLOCK_SCALE_ENABLE || HD44780_BL_CTRL)
+	uint16_t		idle;			// Scans since last input change, saturates
+#endif
+};
+
 struct ENCODER_STRUCT
 {
-	int8_t			prev_state,		// Previous state line in zero by default
-					value;			// Encoder pulse counter
+	int8_t			value;			// Encoder pulse counter
+#if (ENC_ACCEL_ENABLE)
+	uint8_t			gap,			// Milliseconds since last processed detent, saturates
+					gap_avg;		// Running average of gap
+#endif
 	struct {
 		enum        BUTTON_EVENTS_ENUM  event; // Key pressed event type
 		enum		BUTTON_STATE_ENUM	state; // Current button state
-		uint8_t		time;	// Button pressed counter
+		uint16_t	time;	// Button pressed time, scans
 	} button;
 };
 
+struct CHANNEL_STRUCT
+{
+	int8_t			time[3];	// Time left, shared tick keeps it while stopped only, edited in setup modes
+#if (TIMER_SHARED)
+	uint8_t			next;		// Next channel in expiry list
+	uint32_t		expiry;		// Shared tick count when running channel finishes
+	uint16_t		phase;		// Counts into current second at pause, 0 - start on full second
+#endif
+#if (PROG_ENABLE)
+	uint8_t			prog,		// Cycle program number, 0 - single countdown
+					pc,			// Next program step, PROG_PC_IDLE if not started
+					loop,		// Passes done by current loop
+					out;		// Program holds channel output on
+#endif
+};
+
+enum PROG_OP_ENUM
+{
+	PROG_OP_OUT,				// Switch channel output, hold for arg seconds, 0 - go on at once
+	PROG_OP_LOOP,				// Jump to step in output field until arg passes are done
+	PROG_OP_END,				// Outputs off, program finished, so is any unknown opcode
+	PROG_OPS_COUNT
+};
+
+struct PROG_STEP_STRUCT
+{
+	uint8_t			op,			// PROG_OP_ENUM
+					output;		// Channel output, 0 - off, or loop target step
+	uint16_t		arg;		// Duration in seconds or loop passes
+};
+
+#if (CHANNELS_COUNT > 1)
+struct CHANNEL_OUTPUT_STRUCT
+{
+	volatile uint8_t *port;		// Output port register
+	uint8_t			mask;		// Output pin mask
+};
+#endif
+
+struct EEPROM_SAVE_STRUCT
+{
+	uint8_t			pending,	// Bit per channel waiting to be saved
+					load,		// Bit per channel waiting to be loaded
+					ch,			// Channel being saved
+					left;		// Bytes of channel left to write, 0 - none
+};
+
+struct STOPWATCH_STRUCT
+{
+	uint32_t		ticks;		// Shared tick count at start, seconds counted while paused
+	uint16_t		count;		// Timer counter at start, counts past seconds while paused
+	uint8_t			minutes,	// Minutes on screen, 0xFF - redraw all
+					seconds;	// Seconds on screen
+};
+
+struct SCHED_ENTRY_STRUCT
+{
+	uint8_t			days,		// Weekday bit mask, bit 0 - Monday, 0 - empty entry
+					action;		// Channel number, SCHED_START to switch its output on
+	uint16_t		minute;		// Minutes since midnight
+};
+
+struct SCHED_STRUCT
+{
+	uint32_t		now,		// Seconds since Monday 00:00, counted by tick ISR once set
+					next;		// Clock value of next event, SCHED_NONE if none
+	int8_t			time[3];	// Time of day edited in setup modes
+	uint8_t			day;		// Weekday edited in program mode, 0 - Monday
+};
+
 struct TIMER_STRUCT
 {
-	int8_t			time[3];	// Time counter
+	struct CHANNEL_STRUCT channel[CHANNELS_COUNT];
+#if (TIMER_SHARED)
+	uint32_t		ticks;		// Shared tick counter, counts while any channel runs
+#endif
+#if (TIMER_TICK_TRIM_ENABLE)
+	uint8_t			trim;		// Fraction of a count carried into next period, 1/256
+#endif
+	volatile uint8_t running;	// Bit per running channel, STOPWATCH bit for stopwatch
+#if (TIMER_SHARED)
+	uint8_t			head;		// Running channel to finish first, sorted by expiry
+#endif
+#if (TIMER_SHARED || CLOCK_SCALE_ENABLE)
+	volatile uint8_t seq;		// Bumped by tick ISR after each countdown step
+#endif
+	uint8_t			selected;	// Channel shown and edited or STOPWATCH
 	enum		    MODE_ENUM			mode;
+	uint8_t			cursor;		// Cursor column or 0 if hidden
 };
 
 struct FLAGS_STRUCT
 {
-    uint8_t         led_blink,      //
-                    buzzer_blink;   //
+    uint8_t         led_blink;      //
+#if (!BUZZER_PATTERN_ENABLE)
+    uint8_t         buzzer_blink;   //
+#endif
+};
+
+#if (BUZZER_PATTERN_ENABLE)
+enum BUZZER_TONE_ENUM
+{
+	BUZZER_TONE_DC,				// Steady level for active buzzer
+	BUZZER_TONE_OC0B			// Hardware square wave on OC0B
+};
+
+enum BUZZER_PATTERN_ENUM
+{
+	BUZZER_PATTERN_ALARM		// Countdown finished
+};
+
+struct BUZZER_PATTERN_STRUCT
+{
+	uint8_t			count,			// Beeps count
+					on_time,		// Beep length in 10ms units
+					off_time,		// Pause length in 10ms units
+					tone;			// BUZZER_TONE_ENUM
+};
+
+struct BUZZER_STRUCT
+{
+	const struct BUZZER_PATTERN_STRUCT	*pattern;	// Pattern in flash
+	uint8_t			cycle;			// Phases left, even - beep, odd - pause
+};
+#endif
+
+enum UI_EVENT_ENUM
+{
+	UI_EVENT_ROTATE,			// Encoder rotated
+	UI_EVENT_SHORT_PRESS,		// Same value as BUTTON_EVENT_SHORT_PRESS
+	UI_EVENT_LONG_PRESS,		// Same value as BUTTON_EVENT_LONG_PRESS
+	UI_EVENTS_COUNT
+};
+
+enum UI_ACTION_ENUM
+{
+	UI_ACTION_NONE,				// Nothing to do
+	UI_ACTION_START_STOP,		// Toggle selected channel if time is set
+	UI_ACTION_SETUP,			// Enter setup if selected channel is stopped
+	UI_ACTION_LOAD,				// Load timer value from EEPROM
+	UI_ACTION_SAVE,				// Save timer value into EEPROM
+#if (UI_PAGES > 1)
+	UI_ACTION_SELECT,			// Show next or previous channel or stopwatch
+#endif
+#if (DIAG_ENABLE)
+	UI_ACTION_DIAG_OPEN,		// Show first diagnostics page
+	UI_ACTION_DIAG_NEXT,		// Show next diagnostics page
+	UI_ACTION_REDRAW,			// Restore countdown screen
+#endif
+#if (PROG_ENABLE)
+	UI_ACTION_PROGRAM,			// Select cycle program of channel
+#endif
+	UI_ACTION_EDIT				// Change value, UI_ACTION_EDIT + position
+};
+
+struct UI_TRANSITION_STRUCT
+{
+	uint8_t			next_mode,		// Mode after transition
+					action,			// Action to run, may cancel transition
+					cursor;			// Cursor column or 0 to hide cursor
 };
 
 // Max time values:                                 h,  m,  s
 const	uint8_t		max_time_values[3] PROGMEM = { 47, 59, 59 };
+#if (SCHED_ENABLE)
+const	uint8_t		max_clock_values[3] PROGMEM = { 23, 59, 59 };
+#endif
+
+#if (ENC_ACCEL_ENABLE)
+struct ENC_ACCEL_STRUCT
+{
+	uint8_t			gap_max,		// Average detent gap in ms up to which step applies
+					step;			// Value change per detent
+};
+
+// Encoder acceleration, fastest first, slower spins step by one
+const	struct		ENC_ACCEL_STRUCT		enc_accel[] PROGMEM = {
+	{ 30,	10 },					// Over ~33 detents per second
+	{ 80,	5 }						// Over ~12 detents per second
+};
+#endif
+
+///////////////
+//00:00:00 P1//
+// |: |: |  |//
+//0123456789A// <- Cursor column index, A is 10
+///////////////
+// UI transitions indexed by [MODE_ENUM][UI_EVENT_ENUM]
+const	struct		UI_TRANSITION_STRUCT	ui_transitions[][UI_EVENTS_COUNT] PROGMEM = {
+	// MODE_NORMAL
+	{
+#if (UI_PAGES > 1)
+		{ MODE_NORMAL,            UI_ACTION_SELECT,             0 },	// Rotate
+#else
+		{ MODE_NORMAL,            UI_ACTION_NONE,               0 },	// Rotate
+#endif
+		{ MODE_NORMAL,            UI_ACTION_START_STOP,         0 },	// Short press
+		{ MODE_SET_TIMER_SECONDS, UI_ACTION_SETUP,              7 }		// Long press
+	},
+	// MODE_SET_TIMER_SECONDS
+	{
+		{ MODE_SET_TIMER_SECONDS, UI_ACTION_EDIT + SECONDS,     7 },
+		{ MODE_SET_TIMER_MINUTES, UI_ACTION_NONE,               4 },
+		{ MODE_SET_TIMER_SECONDS, UI_ACTION_LOAD,               7 }
+	},
+	// MODE_SET_TIMER_MINUTES
+	{
+		{ MODE_SET_TIMER_MINUTES, UI_ACTION_EDIT + MINUTES,     4 },
+		{ MODE_SET_TIMER_HOURS,   UI_ACTION_NONE,               1 },
+#if (DIAG_ENABLE)
+		{ MODE_DIAG,              UI_ACTION_DIAG_OPEN,          0 }
+#else
+		{ MODE_SET_TIMER_MINUTES, UI_ACTION_NONE,               4 }
+#endif
+	},
+	// MODE_SET_TIMER_HOURS
+	{
+		{ MODE_SET_TIMER_HOURS,   UI_ACTION_EDIT + HOURS,       1 },
+#if (PROG_ENABLE)
+		{ MODE_SET_PROGRAM,       UI_ACTION_NONE,              10 },
+#else
+		{ MODE_NORMAL,            UI_ACTION_NONE,               0 },
+#endif
+		{ MODE_SET_TIMER_HOURS,   UI_ACTION_SAVE,               1 }
+	},
+#if (PROG_ENABLE)
+	// MODE_SET_PROGRAM
+	{
+		{ MODE_SET_PROGRAM,       UI_ACTION_PROGRAM,           10 },
+		{ MODE_NORMAL,            UI_ACTION_NONE,               0 },
+		{ MODE_SET_PROGRAM,       UI_ACTION_SAVE,              10 }
+	},
+#endif
+#if (DIAG_ENABLE)
+	// MODE_DIAG
+	{
+		{ MODE_DIAG,              UI_ACTION_DIAG_NEXT,          0 },
+		{ MODE_NORMAL,            UI_ACTION_REDRAW,             0 },
+		{ MODE_DIAG,              UI_ACTION_NONE,               0 }
+	}
+#endif
+};
+
+#if (BUZZER_PATTERN_ENABLE)
+// Buzzer patterns indexed by BUZZER_PATTERN_ENUM
+const	struct		BUZZER_PATTERN_STRUCT	buzzer_patterns[] PROGMEM = {
+	/* BUZZER_PATTERN_ALARM */ { BUZZER_BEEP_COUNT, 50, 50, BUZZER_PASSIVE ? BUZZER_TONE_OC0B : BUZZER_TONE_DC }
+};
+#endif
+
+#if (CHANNELS_COUNT > 1)
+// Channel outputs indexed by channel
+const	struct		CHANNEL_OUTPUT_STRUCT	channel_outputs[CHANNELS_COUNT] PROGMEM = {
+	{ &RELAY_PORT,    RELAY_MASK },
+	{ &CHANNEL1_PORT, CHANNEL1_MASK },
+#if (CHANNELS_COUNT > 2)
+	{ &CHANNEL2_PORT, CHANNEL2_MASK },
+#endif
+};
+#endif
+
+#if (PROG_ENABLE)
+// Built-in cycle programs, a program switches the output of its own channel only
+const	struct		PROG_STEP_STRUCT		prog_steps[] PROGMEM = {
+	// 0: on 10s, off 50s, 10 passes
+	{ PROG_OP_OUT,  1,    10 },
+	{ PROG_OP_OUT,  0,    50 },
+	{ PROG_OP_LOOP, 0,    10 },
+	{ PROG_OP_END,  0,    0 },
+	// 4: on 30s, off 30s, on 30s
+	{ PROG_OP_OUT,  1,    30 },
+	{ PROG_OP_OUT,  0,    30 },
+	{ PROG_OP_OUT,  1,    30 },
+	{ PROG_OP_END,  0,    0 }
+};
+#define PROG_FLASH_STEPS				(sizeof(prog_steps) / sizeof(prog_steps[0]))
+
+// First step of each program, program number 1 is first entry
+const	uint8_t		prog_table[] PROGMEM = { 0, 4, PROG_PC_EEPROM | 0 };
+#define PROG_COUNT						sizeof(prog_table)
+#endif
+
+// Quadrature decoder: steps indexed by (previous state << 2 | current state)
+const	int8_t		encoder_steps[16] PROGMEM = {
+	 0, -1, +1,  0,
+	+1,  0,  0, -1,
+	-1,  0,  0, +1,
+	 0, +1, -1,  0
+};
 
 /* Timer vars */
 struct				TIMER_STRUCT		timer;
 
+#if (STOPWATCH_ENABLE)
+/* Stopwatch vars */
+struct				STOPWATCH_STRUCT	stopwatch;
+#endif
+
+#if (SCHED_ENABLE)
+/* Time of day clock and planned event */
+struct				SCHED_STRUCT		sched;
+#endif
+
+/* Background EEPROM saver */
+struct				EEPROM_SAVE_STRUCT	save;
+
+/* Page labels on screen, 0xFF - redraw */
+uint8_t								labels_drawn;
+
+#if (BUZZER_PATTERN_ENABLE)
+/* Buzzer pattern sequencer */
+struct				BUZZER_STRUCT		buzzer;
+#else
 /* Buzzer cycle counter */
 uint8_t             buzzer_cycle=(BUZZER_BEEP_COUNT * 2);
+#endif
+
+/* Debounced input pins */
+struct				INPUT_STRUCT		input;
 
 /* Encoder state vars */
 struct				ENCODER_STRUCT		encoder;
@@ -79,8 +433,31 @@ struct				ENCODER_STRUCT		encoder;
 /*  */
 struct              FLAGS_STRUCT        flags;
 
-/* Saved timer value */
-uint8_t		EEMEM	EE_timer_value[3];
+/* Saved timer values, one per channel */
+uint8_t		EEMEM	EE_timer_value[CHANNELS_COUNT][3];
+
+#if (PROG_ENABLE)
+/* Saved program numbers, one per channel */
+uint8_t		EEMEM	EE_timer_prog[CHANNELS_COUNT];
+
+/* User cycle programs, written with .eep image */
+struct		PROG_STEP_STRUCT	EEMEM	EE_prog_steps[PROG_EEPROM_STEPS] = {
+	// 0: pulse 1s every minute for an hour
+	{ PROG_OP_OUT,  1,    1 },
+	{ PROG_OP_OUT,  0,    59 },
+	{ PROG_OP_LOOP, 0,    60 },
+	{ PROG_OP_END,  0,    0 }
+};
+#endif
+
+#if (SCHED_ENABLE)
+/* Schedule entries, written with .eep image */
+struct		SCHED_ENTRY_STRUCT	EEMEM	EE_sched[SCHED_ENTRIES] = {
+	// Relay on from 07:30 to 18:00 on working days
+	{ 0x1F, SCHED_START | 0, 7 * 60 + 30 },
+	{ 0x1F, 0,               18 * 60 }
+};
+#endif
 
 
 //------------------------------ Toggling LED and BEZZER indicators
@@ -90,7 +467,7 @@ void AUTO_ToggleOutputs(void)
     if(!flags.led_blink) {
         TICK_LED_OFF();
     }
-
+#if (!BUZZER_PATTERN_ENABLE)
 	// Control BUZZER IO with BUZZER flag state and BUZZER cycle counter
     if(flags.buzzer_blink && buzzer_cycle--) {
         BUZZER_TOGGLE();
@@ -101,131 +478,902 @@ void AUTO_ToggleOutputs(void)
 		// Flush BUZZER flag
         flags.buzzer_blink=0;
     }
+#endif
+#if (HD44780_BL_CTRL)
+	// Dim back light when nobody is at the device
+	if(input.idle >= BACKLIGHT_DIM_IDLE_MS / INPUT_SCAN_MS) hd44780_Backlight(BACKLIGHT_DIM);
+#endif
+#if (CLOCK_SCALE_ENABLE)
+	// Slow clock only while countdown runs untouched on channel screen
+	clock_Set(TIMER_TICK_CHECK && timer.mode == MODE_NORMAL && timer.selected != STOPWATCH && input.idle >= CLOCK_SLOW_IDLE_MS / INPUT_SCAN_MS);
+#endif
 	// Run this task every ~500ms
     RTOS_SetTimerTask(AUTO_ToggleOutputs, 500);
 }
 
-//------------------------------ Key code processing
-void keyProcessing(void)
+#if (BUZZER_PATTERN_ENABLE)
+//------------------------------ Buzzer pattern step, runs once per beep or pause
+void buzzerStep(void)
 {
-	// Processing button events
-	if(encoder.button.event == BUTTON_EVENT_SHORT_PRESS) {
-		// Event: short click detected
-		// Processing with mode
-		if(timer.mode != MODE_NORMAL) {
-			//> Mode is setting time
-			// Set next mode
-			switch(timer.mode) {
-				case MODE_SET_TIMER_SECONDS: timer.mode = MODE_SET_TIMER_MINUTES; break;
-				case MODE_SET_TIMER_MINUTES: timer.mode = MODE_SET_TIMER_HOURS; break;
-				default: timer.mode = MODE_NORMAL; break;
-			}
+	const struct BUZZER_PATTERN_STRUCT *p = buzzer.pattern;
+	uint8_t time;
+
+	if(!(buzzer.cycle & 0x01)) {
+		// Beep phase: edges are generated by timer hardware
+		if(pgm_read_byte(&p->tone) == BUZZER_TONE_OC0B) {
+			BUZZER_TONE_ON();
 		} else {
-			//> Mode is NORMAL
-            // Check Timer time more than zero
-            uint8_t t = (timer.time[SECONDS] + timer.time[MINUTES] + timer.time[HOURS]);
-            if(t) {
-                // Start timer tick
-                //TIMER_TICK_INTERRUPT_TOGGLE();
-				TIMER_TICK_TOGGLE();
-                //
-                flags.led_blink ^= 0x1;
-				// Relay switch ON
-				RELAY_TOGGLE();
-            }
+			BUZZER_ON();
 		}
+		time = pgm_read_byte(&p->on_time);
 	} else {
-		// Event: long click detected
-		// Set next action
-		switch(timer.mode) {
-			// Go to seconds setup mode
-			case MODE_NORMAL:
-				if(!TIMER_TICK_CHECK) {
-					timer.mode = MODE_SET_TIMER_SECONDS;
+		// Pause phase
+		BUZZER_OFF();
+		time = pgm_read_byte(&p->off_time);
+	}
+	// Run next phase while pattern is not finished
+	if(--buzzer.cycle) {
+		RTOS_SetTimerTask(buzzerStep, time * 10);
+	}
+}
+
+//------------------------------ Start buzzer pattern
+void buzzerPlay(uint8_t pattern)
+{
+	BUZZER_OFF();
+	buzzer.pattern = &buzzer_patterns[pattern];
+	buzzer.cycle = pgm_read_byte(&buzzer.pattern->count) * 2;
+	buzzerStep();
+}
+
+//------------------------------ Countdown finished alarm
+void buzzerAlarm(void)
+{
+	buzzerPlay(BUZZER_PATTERN_ALARM);
+}
+#endif
+
+//------------------------------ Set channel output pin
+void channelOutput(uint8_t ch, uint8_t on)
+{
+#if (CHANNELS_COUNT > 1)
+	volatile uint8_t *port = pgm_read_ptr(&channel_outputs[ch].port);
+	uint8_t mask = pgm_read_byte(&channel_outputs[ch].mask);
+
+	if(on) {
+		*port |= mask;
+	} else {
+		*port &= ~mask;
+	}
+#else
+	if(on) {
+		RELAY_ON();
+	} else {
+		RELAY_OFF();
+	}
+#endif
+	TRACE_PUT(TRACE_EVENT_RELAY, ch << 1 | on);
+}
+
+#if (TIMER_SHARED)
+//------------------------------ Time h:m:s to seconds, without 32-bit multiply
+uint32_t timeToSeconds(const int8_t *time)
+{
+	uint32_t seconds = (uint16_t)(time[MINUTES] * 60) + time[SECONDS];
+	int8_t h;
+
+	for(h = time[HOURS]; h > 0; h--) seconds += 3600;
+	return seconds;
+}
+
+//------------------------------ Seconds to time h:m:s, without division
+void secondsToTime(uint32_t seconds, int8_t *time)
+{
+	int8_t h = 0, m = 0;
+
+	while(seconds >= 3600) { seconds -= 3600; h++; }
+	while((uint16_t)seconds >= 60) { seconds -= 60; m++; }
+	time[HOURS] = h;
+	time[MINUTES] = m;
+	time[SECONDS] = seconds;
+}
+
+//------------------------------ Consistent copy of channel time left while tick ISR stays enabled
+void timerSnapshot(uint8_t ch, int8_t *time)
+{
+	volatile struct CHANNEL_STRUCT *c = &timer.channel[ch];
+	volatile uint32_t *ticks = &timer.ticks;
+	uint32_t left;
+	uint8_t seq, running, i;
+
+	// Copy again if a tick stepped the counter in the middle of copying
+	do {
+		seq = timer.seq;
+		running = timer.running & (1 << ch);
+		left = c->expiry - *ticks;
+		for(i=0; i < 3; i++) time[i] = c->time[i];
+	} while(seq != timer.seq);
+	// Running channel keeps only its expiry
+	if(running) secondsToTime(left, time);
+}
+
+//------------------------------ Counts into current tick and tick count with due compare match counted, interrupts off
+uint16_t timerPhase(uint32_t *ticks)
+{
+	uint16_t count = TIMER_TICK_COUNTER_REG;
+
+	*ticks = timer.ticks;
+	// Compare matched but tick ISR has not counted it yet
+	if(TIMER_TICK_PENDING && count < TIMER_TICK_OCR_CONST / 2) (*ticks)++;
+	return count;
+}
+
+//------------------------------ Link running channel into expiry list, equal expiries finish on same tick
+void channelLink(uint8_t ch)
+{
+	struct CHANNEL_STRUCT *c = &timer.channel[ch];
+	uint8_t *link = &timer.head;
+
+	while(*link != CHANNEL_NONE && timer.channel[*link].expiry <= c->expiry) link = &timer.channel[*link].next;
+	c->next = *link;
+	*link = ch;
+}
+#else
+//------------------------------ Consistent copy of channel time left, 3 bytes need no retry loop
+void timerSnapshot(uint8_t ch, int8_t *time)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		time[HOURS] = timer.channel[ch].time[HOURS];
+		time[MINUTES] = timer.channel[ch].time[MINUTES];
+		time[SECONDS] = timer.channel[ch].time[SECONDS];
+	}
+}
+#endif
+
+#if (PROG_ENABLE)
+//------------------------------ Read program step from flash or EEPROM, step past end of its table reads as END
+void progFetch(uint8_t pc, struct PROG_STEP_STRUCT *step)
+{
+	uint8_t i = pc & ~PROG_PC_EEPROM;
+
+	step->op = PROG_OP_END;
+	if(pc & PROG_PC_EEPROM) {
+		if(i < PROG_EEPROM_STEPS) eeprom_read_block(step, &EE_prog_steps[i], sizeof(*step));
+	} else {
+		if(i < PROG_FLASH_STEPS) memcpy_P(step, &prog_steps[i], sizeof(*step));
+	}
+}
+
+//------------------------------ Run program up to next timed step, returns its duration or 0 when finished
+uint16_t progRun(uint8_t ch)
+{
+	struct CHANNEL_STRUCT *c = &timer.channel[ch];
+	struct PROG_STEP_STRUCT step;
+	uint8_t n, on;
+
+	// Untimed steps are limited, a loop without timed step would hold tick ISR
+	for(n=0; n < PROG_RUN_LIMIT; n++) {
+		progFetch(c->pc++, &step);
+		switch(step.op) {
+			case PROG_OP_OUT:
+				on = (step.output != 0);
+				if(on != c->out) channelOutput(ch, on);
+				c->out = on;
+				if(step.arg) return step.arg;
+				continue;
+			case PROG_OP_LOOP:
+				// One loop counter, loops do not nest. Target stays in table of the loop,
+				// past its end it ends the program
+				if(++c->loop < step.arg) {
+					c->pc = (c->pc & PROG_PC_EEPROM) | (step.output & ~PROG_PC_EEPROM);
+				} else {
+					c->loop = 0;
 				}
-				break;
-			// Go to loading timer value from EEPROM
-            case MODE_SET_TIMER_SECONDS:
-                // Waiting for EEPROM ready
-                while(!eeprom_is_ready());
-                // Read data block
-                eeprom_read_block(&timer.time, &EE_timer_value, sizeof(timer.time));
-                break;
-			// Go to saving timer value in EEPROM
-            case MODE_SET_TIMER_HOURS:
-                // Waiting for EEPROM ready
-                while(!eeprom_is_ready());
-                // Write data block
-                eeprom_write_block(&timer.time, &EE_timer_value, sizeof(timer.time));
-                break;
-			// Nothing to do
-			default: break;
+				continue;
 		}
+		break;
 	}
-	// Flush button event
-	encoder.button.event = BUTTON_EVENT_NOT_PRESSED;
+	// End of program or unknown opcode
+	if(c->out) channelOutput(ch, 0);
+	c->out = 0;
+	c->pc = PROG_PC_IDLE;
+	return 0;
+}
+#endif
+
+//------------------------------ Switch channel output, started program switches it only while holding it on
+void channelSwitch(uint8_t ch, uint8_t on)
+{
+#if (PROG_ENABLE)
+	struct CHANNEL_STRUCT *c = &timer.channel[ch];
+
+	// Paused program keeps its output state for resume
+	if(c->pc != PROG_PC_IDLE) {
+		if(c->out) channelOutput(ch, on);
+		return;
+	}
+#endif
+	channelOutput(ch, on);
+}
+
+#if (TIMER_SHARED)
+//------------------------------ Start or pause channel, stopped channel starts if time is set
+void channelToggle(uint8_t ch)
+{
+	struct CHANNEL_STRUCT *c = &timer.channel[ch];
+	uint32_t seconds = timeToSeconds(c->time), ticks;
+	uint8_t mask = 1 << ch, paused = 0, *link;
+	int16_t shift;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if(timer.running & mask) {
+			// Pause: unlink from expiry list, whole seconds left are converted below,
+			// counts into current second are kept for resume
+			c->phase = timerPhase(&ticks);
+			seconds = c->expiry - ticks;
+			paused = 1;
+			for(link = &timer.head; *link != ch; link = &timer.channel[*link].next);
+			*link = c->next;
+			timer.running &= ~mask;
+			channelSwitch(ch, 0);
+			// Last channel stops the timer
+			if(!timer.running) TIMER_TICK_TOGGLE();
+		} else {
+#if (PROG_ENABLE)
+			// Program starts from first step, paused program resumes its step
+			if(c->prog && c->pc == PROG_PC_IDLE) {
+				c->pc = pgm_read_byte(&prog_table[c->prog - 1]);
+				c->loop = 0;
+				c->out = 0;
+				seconds = progRun(ch);
+			}
+#endif
+			if(seconds) {
+				if(timer.running) {
+					// Timer phase is shared, round joining channel to nearest tick
+					shift = timerPhase(&ticks) - c->phase;
+					if(shift >= (int16_t)(TIMER_TICK_OCR_CONST / 2)) {
+						seconds++;
+					} else if(shift < -(int16_t)(TIMER_TICK_OCR_CONST / 2) && seconds > 1) {
+						seconds--;
+					}
+				} else {
+					// First channel starts the timer on its own phase, exact to one count.
+					// Counter past a shorter trimmed period would run to overflow
+					TIMER_TICK_COUNTER_REG = (c->phase < TIMER_TICK_OCR_REG) ? c->phase : TIMER_TICK_OCR_REG - 1;
+					TIMER_TICK_TOGGLE();
+					ticks = timer.ticks;
+				}
+				c->phase = 0;
+				c->expiry = ticks + seconds;
+				channelLink(ch);
+				timer.running |= mask;
+				channelSwitch(ch, 1);
+			}
+		}
+	}
+	if(paused) secondsToTime(seconds, c->time);
+	flags.led_blink = ((timer.running & TIMER_BLINK_BITS) != 0);
+}
+#else
+//------------------------------ Start or pause channel, stopped channel starts if time is set
+void channelToggle(uint8_t ch)
+{
+	struct CHANNEL_STRUCT *c = &timer.channel[ch];
+	uint8_t mask = 1 << ch;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if(timer.running & mask) {
+			// Pause: tick counter keeps counts into current second for resume
+			timer.running &= ~mask;
+			channelOutput(ch, 0);
+			if(!timer.running) TIMER_TICK_TOGGLE();
+		} else if(c->time[HOURS] | c->time[MINUTES] | c->time[SECONDS]) {
+			if(!timer.running) TIMER_TICK_TOGGLE();
+			timer.running |= mask;
+			channelOutput(ch, 1);
+		}
+	}
+	flags.led_blink = ((timer.running & TIMER_BLINK_BITS) != 0);
+}
+#endif
+
+//------------------------------ Load channel time and program saved in EEPROM, EEPROM must be ready
+void channelLoad(uint8_t ch)
+{
+	struct CHANNEL_STRUCT *c = &timer.channel[ch];
+
+	eeprom_read_block(c->time, &EE_timer_value[ch], 3);
+#if (TIMER_SHARED)
+	c->phase = 0;
+#else
+	TIMER_TICK_COUNTER_REG = 0;
+#endif
+#if (PROG_ENABLE)
+	// Erased or unknown program number means single countdown
+	c->prog = eeprom_read_byte(&EE_timer_prog[ch]);
+	if(c->prog > PROG_COUNT) c->prog = 0;
+	c->pc = PROG_PC_IDLE;
+#endif
+}
+
+#if (STOPWATCH_ENABLE)
+//------------------------------ Now minus stored stopwatch value, returns counts and ticks, interrupts off
+uint16_t stopwatchSince(uint32_t *ticks)
+{
+	int16_t count = timerPhase(ticks);
+
+	count -= stopwatch.count;
+	*ticks -= stopwatch.ticks;
+	if(count < 0) {
+		count += TIMER_TICK_OCR_CONST + 1;
+		(*ticks)--;
+	}
+	return count;
+}
+
+//------------------------------ Stopwatch time from start point or start point from time, interrupts off
+void stopwatchSwap(void)
+{
+	uint32_t ticks;
+
+	// Start point is now minus time, time is now minus start point
+	stopwatch.count = stopwatchSince(&ticks);
+	stopwatch.ticks = ticks;
+}
+
+//------------------------------ Start or pause stopwatch
+void stopwatchToggle(void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		// Timer runs while any channel or stopwatch runs
+		if(!timer.running) TIMER_TICK_TOGGLE();
+		stopwatchSwap();
+		timer.running ^= 1 << STOPWATCH;
+		if(!timer.running) TIMER_TICK_TOGGLE();
+	}
+	flags.led_blink = ((timer.running & TIMER_BLINK_BITS) != 0);
+}
+
+//------------------------------ Draw stopwatch MM:SS.cc, only changed fields are rewritten
+void stopwatchDraw(void)
+{
+	char buffer[4];
+	int8_t time[3];
+	uint32_t ticks;
+	uint16_t count;
+	uint8_t minutes;
+
+	// Running stopwatch keeps start point, time is taken from one timer read
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if(timer.running & (1 << STOPWATCH)) {
+			count = stopwatchSince(&ticks);
+		} else {
+			ticks = stopwatch.ticks;
+			count = stopwatch.count;
+		}
+	}
+	secondsToTime(ticks, time);
+	minutes = time[MINUTES] + time[HOURS] * 60;
+	while(minutes >= 100) minutes -= 100;
+
+	if(minutes != stopwatch.minutes) {
+		hd44780_GoToXY(1, 0);
+		hd44780_Puts(utoa_two_digits(minutes, buffer));
+		hd44780_SendData(':');
+		stopwatch.minutes = minutes;
+		stopwatch.seconds = 0xFF;
+	}
+	if(time[SECONDS] != stopwatch.seconds) {
+		hd44780_GoToXY(1, 3);
+		hd44780_Puts(utoa_two_digits(time[SECONDS], buffer));
+		hd44780_SendData('.');
+		stopwatch.seconds = time[SECONDS];
+	}
+	// Hundredths from 7813 counts per second in 16 bits, 105 / 8192 per 16 counts
+	// is 0.14% over 100 / 7813, so last counts of a second are held at 99
+	count = ((count >> 4) * 105) >> 9;
+	if(count > 99) count = 99;
+	hd44780_GoToXY(1, 6);
+	hd44780_Puts(utoa_two_digits(count, buffer));
+}
+#endif
+
+//------------------------------ EEPROM byte write may start, kept clear of tick ISR which may read program steps
+uint8_t eepromReady(void)
+{
+	if(!eeprom_is_ready()) return 0;
+#if (PROG_ENABLE)
+	// Byte write blocks EEPROM reads, start it only if no tick is due before it ends
+	if(TIMER_TICK_CHECK && (uint16_t)(TIMER_TICK_OCR_REG - TIMER_TICK_COUNTER_REG) <= EEPROM_WRITE_TICK_CLOCKS) return 0;
+#endif
+	return 1;
+}
+
+//------------------------------ Load and save pending channels, one EEPROM access per run, input is scanned meanwhile
+void AUTO_EepromSave(void)
+{
+	struct CHANNEL_STRUCT *c;
+	uint8_t ch, i;
+
+	if(save.load) {
+		// Loads go first, a read waits only for the byte write in progress
+		if(eeprom_is_ready()) {
+			for(ch = 0; !(save.load & (1 << ch)); ch++);
+			save.load &= ~(1 << ch);
+			// Channel started by hand meanwhile keeps its time
+			if(!(timer.running & (1 << ch))) channelLoad(ch);
+		}
+	} else if(save.pending || save.left) {
+		// Next channel once previous one is written, channel saved again meanwhile is queued again
+		if(!save.left) {
+			for(save.ch = 0; !(save.pending & (1 << save.ch)); save.ch++);
+			save.pending &= ~(1 << save.ch);
+			save.left = EEPROM_SAVE_BYTES;
+		}
+		if(eepromReady()) {
+			c = &timer.channel[save.ch];
+			i = EEPROM_SAVE_BYTES - save.left--;
+#if (PROG_ENABLE)
+			if(i == 3) {
+				eeprom_write_byte(&EE_timer_prog[save.ch], c->prog);
+			} else
+#endif
+			eeprom_write_byte(&EE_timer_value[save.ch][i], c->time[i]);
+			if(!save.left) TRACE_PUT(TRACE_EVENT_EEPROM, EEPROM_SAVE_BYTES);
+		}
+	} else {
+		return;
+	}
+	// Check again on next systick, run queue takes it if timer queue is full
+	if(!RTOS_SetTimerTask(AUTO_EepromSave, 0)) RTOS_SetTask(AUTO_EepromSave);
+}
+
+#if (SCHED_ENABLE)
+//------------------------------ Split clock value into time of day, returns weekday
+uint8_t schedSplit(uint32_t now, int8_t *time)
+{
+	uint8_t day = 0;
+
+	while(now >= SCHED_DAY_SECONDS) { now -= SCHED_DAY_SECONDS; day++; }
+	secondsToTime(now, time);
+	return day;
+}
+
+//------------------------------ Seconds from clock value to next time of entry, SCHED_NONE if it never comes
+uint32_t schedDelta(const struct SCHED_ENTRY_STRUCT *e, uint32_t from)
+{
+	// minute * 60 as shifts, no 32-bit multiply
+	uint32_t at = ((uint32_t)e->minute << 6) - (e->minute << 2), best = SCHED_NONE, delta;
+	uint8_t day;
+
+	// Erased entry has minute out of range
+	if(e->minute >= 24 * 60) return SCHED_NONE;
+	for(day = 0; day < 7; day++, at += SCHED_DAY_SECONDS) {
+		if(!(e->days & (1 << day))) continue;
+		// Time at or before clock value comes next week
+		delta = at - from;
+		if((int32_t)delta <= 0) delta += SCHED_WEEK_SECONDS;
+		if(delta < best) best = delta;
+	}
+	return best;
+}
+
+//------------------------------ Plan first event after clock value, nonzero if clock reached it meanwhile
+uint8_t schedPlan(uint32_t from)
+{
+	struct SCHED_ENTRY_STRUCT e;
+	uint32_t best = SCHED_NONE, delta;
+	uint8_t i, due;
+
+	for(i=0; i < SCHED_ENTRIES; i++) {
+		eeprom_read_block(&e, &EE_sched[i], sizeof(e));
+		delta = schedDelta(&e, from);
+		if(delta < best) best = delta;
+	}
+	// Tick ISR compares clock with planned event only
+	if(best != SCHED_NONE) {
+		best += from;
+		if(best >= SCHED_WEEK_SECONDS) best -= SCHED_WEEK_SECONDS;
+	}
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		sched.next = best;
+		due = (sched.now == best);
+	}
+	return due;
+}
+
+//------------------------------ Run entries due at planned event, then plan next one
+void schedFire(void)
+{
+	struct SCHED_ENTRY_STRUCT e;
+	uint32_t at = sched.next;
+	uint8_t i, ch;
+
+#if (CLOCK_SCALE_ENABLE)
+	// Countdown timer is started and stopped at full clock only
+	clock_Set(0);
+#endif
+	for(i=0; i < SCHED_ENTRIES; i++) {
+		eeprom_read_block(&e, &EE_sched[i], sizeof(e));
+		// Due entries come one second after the second before event
+		if(schedDelta(&e, (at ? at : SCHED_WEEK_SECONDS) - 1) != 1) continue;
+		ch = e.action & ~SCHED_START;
+		if(ch >= CHANNELS_COUNT) continue;
+		// Entry takes the output, countdown or program on the channel is paused first
+		if(timer.running & (1 << ch)) channelToggle(ch);
+		channelOutput(ch, (e.action & SCHED_START) != 0);
+	}
+	if(schedPlan(at)) RTOS_SetTask(schedFire);
+}
+
+//------------------------------ Set clock from edited time and weekday, tick starts on a full second if idle
+void schedSet(void)
+{
+	uint32_t now = timeToSeconds(sched.time);
+	uint8_t day;
+
+	for(day = sched.day; day; day--) now += SCHED_DAY_SECONDS;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if(!timer.running) {
+			TIMER_TICK_COUNTER_REG = 0;
+			TIMER_TICK_TOGGLE();
+		}
+		timer.running |= 1 << SCHED_RUNNING;
+		sched.now = now;
+	}
+	if(schedPlan(now)) RTOS_SetTask(schedFire);
+}
+#endif
+
+#if (ENC_ACCEL_ENABLE)
+//------------------------------ Step size for current spin rate
+uint8_t encoderStep(void)
+{
+	uint8_t i;
+
+	// Rate over last few detents, first detent after a pause starts slow
+	if(encoder.gap == 0xFF) {
+		encoder.gap_avg = 0xFF;
+	} else {
+		encoder.gap_avg -= (encoder.gap_avg >> 2) - (encoder.gap >> 2);
+	}
+	for(i=0; i < sizeof(enc_accel) / sizeof(enc_accel[0]); i++) {
+		if(encoder.gap_avg <= pgm_read_byte(&enc_accel[i].gap_max)) return pgm_read_byte(&enc_accel[i].step);
+	}
+	return 1;
+}
+#endif
+
+//------------------------------ Add encoder detents to value wrapping in 0..count-1, no acceleration
+uint8_t encoderWrap(uint8_t value, uint8_t count)
+{
+	int8_t v = value + (encoder.value >> 2);
+
+	while(v >= (int8_t)count) v -= count;
+	while(v < 0) v += count;
+	return v;
 }
 
 //------------------------------ Change time value in position(seconds, minutes, hours)
-void changeValueInPosition(uint8_t p)
+void changeValueInPosition(int8_t *time, const uint8_t *max_values, uint8_t p)
+{
+	int16_t value = (encoder.value >> 2);
+	int8_t carry;
+
+#if (ENC_ACCEL_ENABLE)
+	value *= encoderStep();
+#endif
+	do {
+		uint8_t max_value = pgm_read_byte(max_values + p);
+		value += time[p];
+		// Past range wraps around, remainder of a big step is kept
+		carry = 0;
+		while(value > max_value) { value -= max_value + 1; carry++; }
+		while(value < 0) { value += max_value + 1; carry--; }
+		time[p] = value;
+		value = carry;
+#if (ENC_ACCEL_CARRY)
+	// Wraps carry into next field, hours wrap alone
+	} while(carry && p-- != HOURS);
+#else
+	} while(0);
+#endif
+}
+
+//------------------------------ Run UI action, returns zero to cancel transition
+uint8_t uiAction(uint8_t action)
+{
+	struct CHANNEL_STRUCT *c = &timer.channel[timer.selected];
+#if (SCHED_ENABLE)
+	uint32_t now;
+#endif
+
+	// Change value in position
+	if(action >= UI_ACTION_EDIT) {
+#if (SCHED_ENABLE)
+		// Clock is edited on its copy, set on save
+		if(timer.selected == SCHED_PAGE) {
+			changeValueInPosition(sched.time, max_clock_values, action - UI_ACTION_EDIT);
+			return 1;
+		}
+#endif
+		changeValueInPosition(c->time, max_time_values, action - UI_ACTION_EDIT);
+#if (TIMER_SHARED)
+		// Edited time starts on a full second, paused phase is dropped
+		c->phase = 0;
+#else
+		// Edited time starts on a full second, counts of paused second are dropped
+		TIMER_TICK_COUNTER_REG = 0;
+#endif
+		return 1;
+	}
+
+	switch(action) {
+		// Start or pause selected channel if time is set
+		case UI_ACTION_START_STOP:
+#if (CLOCK_SCALE_ENABLE)
+			// Countdown timer is started and stopped at full clock only
+			clock_Set(0);
+#endif
+#if (STOPWATCH_ENABLE)
+			if(timer.selected == STOPWATCH) {
+				stopwatchToggle();
+				break;
+			}
+#endif
+#if (SCHED_ENABLE)
+			// Set clock is never stopped
+			if(timer.selected == SCHED_PAGE) break;
+#endif
+			channelToggle(timer.selected);
+			break;
+		// Setup is allowed only while selected channel is stopped
+		case UI_ACTION_SETUP:
+#if (SCHED_ENABLE)
+			// Clock keeps running, its time is copied for editing
+			if(timer.selected == SCHED_PAGE) {
+				ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+					now = sched.now;
+				}
+				sched.day = schedSplit(now, sched.time);
+				return 1;
+			}
+#endif
+#if (STOPWATCH_ENABLE)
+			// Stopwatch has no setup, long press clears it while paused
+			if(timer.selected == STOPWATCH) {
+				if(!(timer.running & (1 << STOPWATCH))) {
+					stopwatch.ticks = 0;
+					stopwatch.count = 0;
+				}
+				return 0;
+			}
+#endif
+			return !(timer.running & (1 << timer.selected));
+		// Loading timer value from EEPROM
+		case UI_ACTION_LOAD:
+#if (SCHED_ENABLE)
+			// Clock has nothing saved
+			if(timer.selected == SCHED_PAGE) break;
+#endif
+			// Read by EEPROM task once a byte write in progress ends
+			save.load |= 1 << timer.selected;
+			RTOS_SetTask(AUTO_EepromSave);
+			break;
+		// Saving timer value in EEPROM
+		case UI_ACTION_SAVE:
+#if (SCHED_ENABLE)
+			// Clock is set when long press is released
+			if(timer.selected == SCHED_PAGE) {
+				schedSet();
+				break;
+			}
+#endif
+			// Data is written in background, saver started already picks it up
+			save.pending |= 1 << timer.selected;
+			RTOS_SetTask(AUTO_EepromSave);
+			break;
+#if (PROG_ENABLE)
+		// Encoder picks next or previous program, new program starts from first step
+		case UI_ACTION_PROGRAM:
+#if (SCHED_ENABLE)
+			// Clock page sets weekday in place of program
+			if(timer.selected == SCHED_PAGE) {
+				sched.day = encoderWrap(sched.day, 7);
+				break;
+			}
+#endif
+			c->prog = encoderWrap(c->prog, PROG_COUNT + 1);
+			c->pc = PROG_PC_IDLE;
+			c->phase = 0;
+			break;
+#endif
+#if (UI_PAGES > 1)
+		// Encoder picks next or previous channel or stopwatch
+		case UI_ACTION_SELECT:
+			timer.selected = encoderWrap(timer.selected, UI_PAGES);
+			break;
+#endif
+#if (DIAG_ENABLE)
+		// Diagnostics pages
+		case UI_ACTION_DIAG_OPEN: diag_Open(0); break;
+		case UI_ACTION_DIAG_NEXT: diag_NextPage(); break;
+		// Back to countdown screen
+		case UI_ACTION_REDRAW:
+#if (DIAG_BENCH_ENABLE)
+			// Tick kept on by benchmark stops unless channels need it
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+				if(timer.running == 1 << BENCH_RUNNING) TIMER_TICK_TOGGLE();
+				timer.running &= ~(1 << BENCH_RUNNING);
+			}
+			flags.led_blink = ((timer.running & TIMER_BLINK_BITS) != 0);
+#endif
+			hd44780_Clear();
+			labels_drawn = 0xFF;
+			break;
+#endif
+	}
+	return 1;
+}
+
+//------------------------------ UI event dispatcher
+void uiDispatch(uint8_t event)
+{
+	const struct UI_TRANSITION_STRUCT *t = &ui_transitions[timer.mode][event];
+
+	// Run action and take transition if action allows it
+	if(uiAction(pgm_read_byte(&t->action))) {
+		timer.mode = pgm_read_byte(&t->next_mode);
+		timer.cursor = pgm_read_byte(&t->cursor);
+	}
+}
+
+//------------------------------ Key code processing
+void keyProcessing(void)
 {
-	timer.time[p] += (encoder.value >> 2);
-	uint8_t max_value = pgm_read_byte(max_time_values + p);
-	if(timer.time[p] > max_value) timer.time[p] = 0;
-	if(timer.time[p] < 0) timer.time[p] = max_value;
+	// Button event codes match UI events
+	uiDispatch(encoder.button.event);
+	// Flush button event
+	encoder.button.event = BUTTON_EVENT_NOT_PRESSED;
 }
 
 //------------------------------ Encoder value processing
 void encProcessing(void)
 {
-	// Processing value change with mode
-	switch(timer.mode) {
-        // Change value in SECONDS position
-		case MODE_SET_TIMER_SECONDS: changeValueInPosition(SECONDS); break;
-        // Change value in MINUTES position
-		case MODE_SET_TIMER_MINUTES: changeValueInPosition(MINUTES); break;
-        // Change value in HOURS position
-		case MODE_SET_TIMER_HOURS: changeValueInPosition(HOURS); break;
-        // Other
-		default: break;
-	}
+	uiDispatch(UI_EVENT_ROTATE);
     // Flush encoder value after processing
 	encoder.value=0;
+#if (ENC_ACCEL_ENABLE)
+	// Next detent gap is counted from here
+	encoder.gap=0;
+#endif
+}
+
+//------------------------------ Page title and labels, redrawn when page or program changes
+void displayLabels(void)
+{
+	uint8_t labels = timer.selected;
+
+#if (PROG_ENABLE)
+	if(timer.selected < CHANNELS_COUNT) labels |= timer.channel[timer.selected].prog << 4;
+#endif
+	if(labels == labels_drawn) return;
+	labels_drawn = labels;
+	hd44780_GoToXY(0, 0);
+#if (STOPWATCH_ENABLE)
+	if(timer.selected == STOPWATCH) {
+		hd44780_PutsF(ST_STR(STR_STOPWATCH));
+		// Clear program label, all digits are drawn next
+		hd44780_GoToXY(1, 9);
+		hd44780_SendData(' ');
+		hd44780_SendData(' ');
+		stopwatch.minutes = 0xFF;
+		return;
+	}
+#endif
+#if (SCHED_ENABLE)
+	// Time and weekday are drawn by updater
+	if(timer.selected == SCHED_PAGE) {
+		hd44780_PutsF(ST_STR(STR_SCHED));
+		return;
+	}
+#endif
+	hd44780_PutsF(ST_STR(STR_TITLE));
+	hd44780_SendData(' ');
+#if (CHANNELS_COUNT > 1)
+	// Channel number after title
+	hd44780_SendData('1' + timer.selected);
+#else
+	hd44780_SendData(' ');
+#endif
+	hd44780_SendData(' ');
+#if (PROG_ENABLE)
+	// Program number, 0 - single countdown
+	hd44780_GoToXY(1, 9);
+	hd44780_SendData('P');
+	hd44780_SendData('0' + (labels >> 4));
+#endif
 }
 
 //------------------------------ Display update function
 void AUTO_DisplayUpdater(void)
 {
 	char buffer[4];
+	int8_t time[3];
+#if (SCHED_ENABLE)
+	uint32_t now;
+	uint8_t day;
+#endif
 
+#if (DIAG_ENABLE)
+	// Diagnostics pages replace countdown screen
+	if(timer.mode == MODE_DIAG) {
+		hd44780_SendCmd(HD44780_OPT_DISPLAY_ENABLE | HD44780_OPT_CURSOR_INVISIBLE);
+		diag_Update();
+		RTOS_SetTimerTask(AUTO_DisplayUpdater, 100);
+		return;
+	}
+#endif
+
+#if (CLOCK_SCALE_ENABLE)
+	// LCD waits are 16 times longer on slow clock, redraw on countdown step only
+	static uint8_t seq_drawn;
+	if(clock_slow && timer.seq == seq_drawn) {
+		RTOS_SetTimerTask(AUTO_DisplayUpdater, 100);
+		return;
+	}
+	seq_drawn = timer.seq;
+#endif
+	displayLabels();
+#if (STOPWATCH_ENABLE)
+	// Stopwatch page redraws hundredths only, often while it runs
+	if(timer.selected == STOPWATCH) {
+		stopwatchDraw();
+		RTOS_SetTimerTask(AUTO_DisplayUpdater, (timer.running & (1 << STOPWATCH)) ? STOPWATCH_REDRAW_MS - 1 : 100);
+		return;
+	}
+#endif
+#if (SCHED_ENABLE)
+	// Clock page shows edited copy in setup modes
+	if(timer.selected == SCHED_PAGE) {
+		if(timer.cursor) {
+			time[HOURS] = sched.time[HOURS];
+			time[MINUTES] = sched.time[MINUTES];
+			time[SECONDS] = sched.time[SECONDS];
+			day = sched.day;
+		} else {
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+				now = sched.now;
+			}
+			day = schedSplit(now, time);
+		}
+		// Weekday in place of program number
+		hd44780_GoToXY(1, 9);
+		hd44780_SendData(pgm_read_byte(ST_STR(STR_WEEKDAYS) + day * 2));
+		hd44780_SendData(pgm_read_byte(ST_STR(STR_WEEKDAYS) + day * 2 + 1));
+	} else
+#endif
+	// Take all positions from one countdown step
+	timerSnapshot(timer.selected, time);
 	// Moving cursor to second string begin
 	hd44780_GoToXY(1, 0);
     // Update data on display in all time positions
     uint8_t i=0;
     do {
         // Update value with conversation
-        hd44780_Puts(utoa_cycle_sub(timer.time[i], buffer));
+        hd44780_Puts(utoa_two_digits(time[i], buffer));
         // If the current position is not the end, print char ":"
-        if(i++ != 2) hd44780_Puts(":");
+        if(i++ != 2) hd44780_SendData(':');
     } while(i<3);
 
     // Cursor visibility rule
-	if(timer.mode != MODE_NORMAL) {
+	if(timer.cursor) {
         // Show squared cursor in SET TIMER modes
 		hd44780_SendCmd(HD44780_OPT_DISPLAY_ENABLE | HD44780_OPT_CURSOR_VISIBLE | HD44780_OPT_CURSOR_IS_SQUARE);
-        // Cursor position selector by modes
-        uint8_t position=1;
-        switch(timer.mode) {
-            ////////////
-            //00:00:00//
-            // |: |: |//
-            //01234567// <- Position index
-            ////////////
-            case MODE_SET_TIMER_SECONDS: position=7; break;
-            case MODE_SET_TIMER_MINUTES: position=4; break;
-            default: break;
-        }
-        hd44780_GoToXY(1, position);
+        // Cursor position from last UI transition
+        hd44780_GoToXY(1, timer.cursor);
 	} else {
         // Hide cursor in NORMAL mode
 		hd44780_SendCmd(HD44780_OPT_DISPLAY_ENABLE | HD44780_OPT_CURSOR_INVISIBLE);
@@ -234,109 +1382,108 @@ void AUTO_DisplayUpdater(void)
 	RTOS_SetTimerTask(AUTO_DisplayUpdater, 100);
 }
 
-//------------------------------ Check button state
-void AUTO_KeyScan(void)
+//------------------------------ Sample encoder and button with one port read, debounce and decode
+void AUTO_InputScan(void)
 {
-    // Processing button state NOT PRESSED(UP)
-	if(encoder.button.state == BUTTON_STATE_UP) {
-		// Check key state
-		if(BTN_PRESSED) {
-			// Button is pressed
-			// Set current state to PRESSED(DN)
+	uint8_t prev = input.state;
+	// Pins that differ from debounced state
+	uint8_t changed = INPUT_STATE ^ prev;
+
+	// Vertical counters: 2-bit counter per pin counts samples that differ,
+	// a pin flips on 4th sample in a row, an equal sample resets its counter.
+	// Encoder pins flip on 2nd, 2 ms apart that is the 4 ms of 1 ms sampling
+	input.cnt0 = ~(input.cnt0 & changed);
+	input.cnt1 = input.cnt0 ^ (input.cnt1 & changed);
+	changed &= input.cnt0 & (input.cnt1 | ENC_MASK);
+	input.state ^= changed;
+
+#if (CLOCK_SCALE_ENABLE || HD44780_BL_CTRL)
+	// Any input brings full clock and brightness back before it is processed
+	if(changed) {
+		input.idle = 0;
+#if (CLOCK_SCALE_ENABLE)
+		clock_Set(0);
+#endif
+#if (HD44780_BL_CTRL)
+		hd44780_Backlight(BACKLIGHT_FULL);
+#endif
+	} else if(input.idle != 0xFFFF) {
+		input.idle++;
+	}
+#endif
+
+	// Encoder step from debounced phases
+	if(changed & ENC_MASK) {
+		DIAG_BENCH_ENCODER(changed);
+		encoder.value += (int8_t)pgm_read_byte(encoder_steps + ((prev & ENC_MASK) << 2 | (input.state & ENC_MASK)));
+	}
+#if (ENC_ACCEL_ENABLE)
+	// Time since last processed detent for acceleration
+	encoder.gap = (encoder.gap < 0xFF - INPUT_SCAN_MS) ? encoder.gap + INPUT_SCAN_MS : 0xFF;
+#endif
+	// Full detent collected, request again until it is processed
+	if(encoder.value > 3 || encoder.value < -3) {
+		RTOS_SetTask(encProcessing);
+	}
+
+	// Button is active low
+	if(!(input.state & BTN_MASK)) {
+		if(changed & BTN_MASK) {
+			// Pressed, start hold timer
 			encoder.button.state = BUTTON_STATE_DN;
-			// Flush pressed state timer
-            encoder.button.time = 0;
-            // If key pressed event was not processed
-            if(!encoder.button.event) {
-                // Set flag to SHORT click
-                encoder.button.event = BUTTON_EVENT_SHORT_PRESS;
-            }
-		} else if(encoder.button.event) {
-            // If key not pressed, but set event
-			// Run task with key processing
-			RTOS_SetTask(keyProcessing);
-		}
-	// Processing button state PRESSED(DN)
-	} else if(encoder.button.state == BUTTON_STATE_DN) {
-		// Check key state
-		if(BTN_PRESSED) {
-			// If timer long click not tick yet
-			if(encoder.button.time < 30) {
-				// Increment timer
-                encoder.button.time++;
-			    // Else
-			} else {
-				// Flush long click
-                encoder.button.time = 0;
-				// Set current state to LONG PRESSED(AL)
-				encoder.button.event = BUTTON_STATE_AL;
-			}
-		// If key not pressed yet
-		} else {
-			// Set current state to NOT PRESSED(UP)
-            encoder.button.state = BUTTON_STATE_UP;
-			// Flush pressed state timer
-            encoder.button.time = 0;
+			encoder.button.time = 0;
+		} else if(encoder.button.state == BUTTON_STATE_DN) {
+			// Held long enough for long press
+			encoder.button.time++;
+			if(encoder.button.time >= INPUT_LONG_PRESS_MS / INPUT_SCAN_MS) encoder.button.state = BUTTON_STATE_AL;
 		}
-	// Processing button state LONG PRESSED(AL)
-	} else if(encoder.button.state == BUTTON_STATE_AL) {
-		// Waiting while key will not be pressed
-		if(!BTN_PRESSED) {
-			// Set current state to NOT PRESSED(UP)
-            encoder.button.state = BUTTON_STATE_UP;
-			// Flush pressed state timer
-            encoder.button.time = 0;
-			// Set flag to LONG click
-            encoder.button.event = BUTTON_EVENT_LONG_PRESS;
+	} else if(changed & BTN_MASK) {
+		// Released, press kind is known now
+		if(encoder.button.state == BUTTON_STATE_AL) {
+			encoder.button.event = BUTTON_EVENT_LONG_PRESS;
+		} else if(encoder.button.state == BUTTON_STATE_DN && !encoder.button.event) {
+			encoder.button.event = BUTTON_EVENT_SHORT_PRESS;
 		}
+		encoder.button.state = BUTTON_STATE_UP;
+	}
+	// Run key processing, request again until it is processed
+	if(encoder.button.state == BUTTON_STATE_UP && encoder.button.event) {
+		RTOS_SetTask(keyProcessing);
 	}
-	// Run this process with periodic ~20ms
-	RTOS_SetTimerTask(AUTO_KeyScan, 20);
+
+	// Timer task runs after time + 1 systicks
+	RTOS_SetTimerTask(AUTO_InputScan, INPUT_SCAN_MS - 1);
 }
 
-//------------------------------ Check encoder state
-void AUTO_EncoderScan(void)
+#if (DIAG_BENCH_ENABLE)
+//------------------------------ Button held since power up for long press opens benchmark pages
+void AUTO_BootHold(void)
 {
-    // Getting current encoder pin state
-    uint8_t curr_state = ENC_STATE;
-    // Processing state
-    switch(encoder.prev_state) {
-        case 0:
-            if(curr_state == 2) encoder.value++;
-            if(curr_state == 1) encoder.value--;
-            break;
-
-        case 1:
-            if(curr_state == 0) encoder.value++;
-            if(curr_state == 3) encoder.value--;
-            break;
-
-        case 2:
-            if(curr_state == 3) encoder.value++;
-            if(curr_state == 0) encoder.value--;
-            break;
-
-        case 3:
-            if(curr_state == 1) encoder.value++;
-            if(curr_state == 2) encoder.value--;
-            break;
-    }
-    // Save last state of encoder pin
-    encoder.prev_state = curr_state;
-    // If counter not null
-    //if(encoder.value != 0) {
-	if(encoder.value > 3 || encoder.value < -3) {
-        RTOS_SetTask(encProcessing);
-    }
-    // Set timer task to autostart this scan procedure every 1ms
-    RTOS_SetTimerTask(AUTO_EncoderScan, 1);
+	// Debounced button is down and no press was seen, so it was never released
+	if((input.state & BTN_MASK) || encoder.button.state != BUTTON_STATE_UP || timer.mode != MODE_NORMAL) return;
+	timer.mode = MODE_DIAG;
+	// Tick error page needs 1 Hz tick running
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if(!timer.running) TIMER_TICK_TOGGLE();
+		timer.running |= 1 << BENCH_RUNNING;
+	}
+	flags.led_blink = 1;
+	diag_Open(DIAG_PAGE_LCD);
 }
+#endif
 
 //------------------------------ Initialize MCU peripheral
 inline void MCU_Init(void)
 {
 	// Initialize RELAY IO
 	RELAY_INIT();
+#if (CHANNELS_COUNT > 1)
+	// Initialize spare channel outputs
+	CHANNEL1_INIT();
+#endif
+#if (CHANNELS_COUNT > 2)
+	CHANNEL2_INIT();
+#endif
 	// Initialize SYSTICK timer for RTOS
 	SYSTICK_TIMER_INIT();
 	SYSTICK_INTERRUPT_ENABLE();
@@ -351,71 +1498,180 @@ inline void MCU_Init(void)
 	TICK_LED_INIT();
 	// Initialize BUZZER IO
 	BUZZER_INIT();
+#if (TRACE_ENABLE)
+	// Initialize TRACE UART IO
+	TRACE_INIT();
+#endif
 }
 
 //------------------------------ Interrupt timer for RTOS
 ISR(TIMER0_COMPA_vect)
 {
+	DIAG_BENCH_SYSTICK();
+#if (HD44780_BL_CTRL && HD44780_BL_PWM)
+	// Back light PWM period starts
+	if(HD44780_BL_PWM_ACTIVE) HD44780_BL_ON();
+#endif
+	RTOS_PROFILE_ISR_BEGIN();
+	TRACE_PUT(TRACE_EVENT_ISR_ENTER, TRACE_ISR_SYSTICK);
 	RTOS_TimerService();
+	TRACE_PUT(TRACE_EVENT_ISR_EXIT, TRACE_ISR_SYSTICK);
+	RTOS_PROFILE_ISR_END(RTOS_PROFILE_ISR_SYSTICK);
 }
 
+#if (HD44780_BL_CTRL && HD44780_BL_PWM)
+ISR(TIMER0_COMPB_vect)
+{
+	// Back light PWM duty ends
+	HD44780_BL_OFF();
+}
+#endif
+
 ISR(TIMER1_COMPA_vect)
 {
-	// Toggle TICK led
-	TICK_LED_TOGGLE();
+	RTOS_PROFILE_ISR_BEGIN();
+	TRACE_PUT(TRACE_EVENT_ISR_ENTER, TRACE_ISR_TICK);
+	DIAG_BENCH_TICK();
+#if (TIMER_TICK_TRIM_ENABLE)
+	// Next period is one count longer when the fraction carries over
+	uint8_t trim = timer.trim;
+	timer.trim += (uint8_t)TIMER_TICK_PERIOD_256;
+	TIMER_TICK_OCR_REG = (TIMER_TICK_PERIOD_256 >> 8) - 1 + (timer.trim < trim);
+#endif
+	// Toggle TICK led while channels run
+	if(flags.led_blink) TICK_LED_TOGGLE();
 
-    // Time processing
-	if(timer.time[SECONDS] == 0) {
-		if(timer.time[MINUTES] == 0) {
-			if(timer.time[HOURS] > 0) {
-				timer.time[HOURS]--;
-                timer.time[MINUTES] = 59;
-                timer.time[SECONDS] = 59;
+#if (TIMER_SHARED)
+	// Only list head can be due, channels finishing on same tick follow it
+	uint32_t ticks = ++timer.ticks;
+	uint8_t ch;
+	while((ch = timer.head) != CHANNEL_NONE && timer.channel[ch].expiry == ticks) {
+		struct CHANNEL_STRUCT *c = &timer.channel[ch];
+		timer.head = c->next;
+#if (PROG_ENABLE)
+		// Program goes to next step in same tick, step expiry counts from last one
+		if(c->pc != PROG_PC_IDLE) {
+			uint16_t duration = progRun(ch);
+			if(duration) {
+				c->expiry += duration;
+				channelLink(ch);
+				continue;
 			}
+		}
+#endif
+		timer.running &= ~(1 << ch);
+		c->time[HOURS] = c->time[MINUTES] = c->time[SECONDS] = 0;
+		// Output switch OFF
+		channelOutput(ch, 0);
+#if (BUZZER_PATTERN_ENABLE)
+		// Run buzzer alarm pattern
+		RTOS_SetTask(buzzerAlarm);
+#else
+		// Set enable buzzer flag
+		flags.buzzer_blink = 1;
+#endif
+	}
+#else
+	// Compare pending when channel was paused is counted, tick is stopped then
+	struct CHANNEL_STRUCT *c = &timer.channel[0];
+	if((timer.running & 1 || !TIMER_TICK_CHECK) && (c->time[HOURS] | c->time[MINUTES] | c->time[SECONDS])) {
+		if(c->time[SECONDS]) {
+			c->time[SECONDS]--;
 		} else {
-            timer.time[MINUTES]--;
-            timer.time[SECONDS] = 59;
+			if(c->time[MINUTES]) {
+				c->time[MINUTES]--;
+			} else {
+				c->time[HOURS]--;
+				c->time[MINUTES] = 59;
+			}
+			c->time[SECONDS] = 59;
+		}
+		// Last second
+		if(!(c->time[HOURS] | c->time[MINUTES] | c->time[SECONDS])) {
+			timer.running &= ~1;
+			// Output switch OFF
+			channelOutput(0, 0);
+#if (BUZZER_PATTERN_ENABLE)
+			// Run buzzer alarm pattern
+			RTOS_SetTask(buzzerAlarm);
+#else
+			// Set enable buzzer flag
+			flags.buzzer_blink = 1;
+#endif
 		}
-	} else {
-        timer.time[SECONDS]--;
 	}
+#endif
+#if (TIMER_SHARED || CLOCK_SCALE_ENABLE)
+	// Readers copying the counter now know it has to be copied again
+	timer.seq++;
+#endif
 
-	// Detecting last second
-	uint8_t t = (timer.time[SECONDS] + timer.time[MINUTES] + timer.time[HOURS]);
-	if(!t) {
-		// Relay switch OFF
-		RELAY_OFF();
+#if (SCHED_ENABLE)
+	// Set clock counts the week, one compare finds the planned event
+	if(timer.running & (1 << SCHED_RUNNING)) {
+		if(++sched.now == SCHED_WEEK_SECONDS) sched.now = 0;
+		if(sched.now == sched.next) RTOS_SetTask(schedFire);
+	}
+#endif
+
+	// Last running channel finished, stopwatch keeps timer running, clock too
+	if(!(timer.running & TIMER_BLINK_BITS)) {
 		// Set disable led flag
 		flags.led_blink = 0;
-		// Set enable buzzer flag
-		flags.buzzer_blink = 1;
 		// Stop timer tick
-		TIMER_TICK_STOP();
+		if(!timer.running) TIMER_TICK_STOP();
 	}
-
-
+	TRACE_PUT(TRACE_EVENT_ISR_EXIT, TRACE_ISR_TICK);
+	RTOS_PROFILE_ISR_END(RTOS_PROFILE_ISR_TICK);
 }
 
+#if (RTOS_WDT_ENABLE)
+// Deadline budgets of periodic tasks, systicks between two runs
+const	struct		RTOS_DEADLINE_STRUCT	RTOS_Deadlines[RTOS_DEADLINES_COUNT] PROGMEM = {
+	{ AUTO_InputScan,		50 },		// Runs every 2ms
+	{ AUTO_ToggleOutputs,	1000 },		// Runs every 500ms
+	{ AUTO_DisplayUpdater,	500 }		// Runs every 100ms, diagnostics pages too
+};
+#endif
+
 //------------------------------ MAIN WORK CYCLE
 int main(void)
 {
 	MCU_Init();
+#if (RTOS_WDT_ENABLE)
+	reset_Init();
+#endif
 	RTOS_Init();
+#if (TIMER_SHARED)
+	timer.head = CHANNEL_NONE;
+#endif
+	labels_drawn = 0xFF;
+#if (PROG_ENABLE)
+	for(uint8_t i=0; i < CHANNELS_COUNT; i++) timer.channel[i].pc = PROG_PC_IDLE;
+#endif
 	hd44780_Init();
+#if (HD44780_BL_CTRL)
+	hd44780_Backlight(BACKLIGHT_FULL);
+#endif
 
     sei();
 
     hd44780_Clear();
-    hd44780_Puts(" Timer:");
+    hd44780_PutsF(ST_STR(STR_TITLE));
 
-	// Run cycle encoder scan
-	RTOS_SetTask(AUTO_EncoderScan);
-	// Run cycle button scan
-	RTOS_SetTask(AUTO_KeyScan);
+	// Inputs start debounced at current pin levels
+	input.state = INPUT_STATE;
+	input.cnt0 = input.cnt1 = 0xFF;
+	// Run cycle encoder and button scan
+	RTOS_SetTask(AUTO_InputScan);
     // Run cylcle update LED and RELAY states
     RTOS_SetTask(AUTO_ToggleOutputs);
 	// Run cycle display updater
     RTOS_SetTask(AUTO_DisplayUpdater);
+#if (DIAG_BENCH_ENABLE)
+	// Button still held after long press time opens benchmark
+	RTOS_SetTimerTask(AUTO_BootHold, INPUT_LONG_PRESS_MS);
+#endif
 
     while (1) {
 		RTOS_TaskManager();
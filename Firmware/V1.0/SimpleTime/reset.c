@@ -0,0 +1,88 @@
+/*
+ * reset.c
+ *
+ * Created: 19.10.2026 16:04:58
+ *  Reset cause and watchdog records
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <avr/io.h>
+#include <avr/eeprom.h>
+
+#include "rtos.h"
+#include "reset.h"
+
+#if (RTOS_WDT_ENABLE)
+// I/O addresses for .init3 asm, register summary of ATtiny2313A datasheet
+#define RESET_MCUSR_IO					0x34
+#define RESET_WDTCSR_IO					0x21
+
+#define RESET_STR(x)					#x
+#define RESET_XSTR(x)					RESET_STR(x)					// Macro value as asm text
+
+/************************************************************************/
+/* VARS                                                                 */
+/************************************************************************/
+// EEPROM erases to 0xFF, counters are stored inverted so a new chip reads zero
+struct	RESET_RECORD_STRUCT		EEMEM	EE_reset_record;
+struct	RESET_RECORD_STRUCT				reset_record;
+
+uint8_t		reset_mcusr __attribute__((section(".noinit")));		// MCUSR copy taken before it is cleared
+
+
+/************************************************************************/
+/* FUNCTIONS                                                            */
+/************************************************************************/
+#if defined(__AVR__)
+//------------------------------ Take reset flags and stop watchdog before .data/.bss init
+// Naked hook, basic asm only; .init2 has cleared r1 and set up SP.
+// Watchdog stays on after its reset with the shortest timeout,
+// WDRF must be cleared before it can be turned off.
+// Deadline misses survive only a watchdog reset, any other cause clears them.
+void reset_Capture(void) __attribute__((naked, used, section(".init3")));
+void reset_Capture(void)
+{
+	__asm volatile (
+		"in		r24, " RESET_XSTR(RESET_MCUSR_IO) "				\n"
+		"sts	reset_mcusr, r24			\n"
+		"sbrs	r24, " RESET_XSTR(WDRF) "				\n"
+		"sts	RTOS_Overruns, r1			\n"
+		"out	" RESET_XSTR(RESET_MCUSR_IO) ", r1				\n"
+		"ldi	r24, " RESET_XSTR((1<<WDCE)|(1<<WDE)) "	\n"
+		"out	" RESET_XSTR(RESET_WDTCSR_IO) ", r24			\n"
+		"out	" RESET_XSTR(RESET_WDTCSR_IO) ", r1				\n"
+	);
+}
+#endif
+
+//------------------------------ Saturating byte add
+static uint8_t reset_Add(uint8_t counter, uint8_t n)
+{
+	return (counter > 0xFF - n) ? 0xFF : counter + n;
+}
+
+//------------------------------ Account last reset, call before RTOS_Init
+void reset_Init(void)
+{
+	struct RESET_RECORD_STRUCT ee;
+
+	eeprom_read_block(&ee, &EE_reset_record, sizeof(ee));
+	reset_record.cause = reset_mcusr;
+	reset_record.wdt_resets = ~ee.wdt_resets;
+	reset_record.overruns = ~ee.overruns;
+
+	// Deadline misses counted before watchdog reset are still in RAM
+	if(reset_mcusr & (1<<WDRF)) {
+		reset_record.wdt_resets = reset_Add(reset_record.wdt_resets, 1);
+		reset_record.overruns = reset_Add(reset_record.overruns, RTOS_Overruns);
+		RTOS_Overruns = 0;
+	}
+
+	// Only changed bytes are written
+	ee.cause = reset_record.cause;
+	ee.wdt_resets = ~reset_record.wdt_resets;
+	ee.overruns = ~reset_record.overruns;
+	eeprom_update_block(&ee, &EE_reset_record, sizeof(ee));
+}
+#endif
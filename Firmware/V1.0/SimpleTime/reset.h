@@ -0,0 +1,28 @@
+/*
+ * reset.h
+ *
+ * Created: 19.10.2026 16:05:12
+ *  Reset cause and watchdog records
+ */
+#ifndef RESET_H
+#define RESET_H
+
+#include <stdio.h>
+
+// Kept in EEPROM across reboots and power loss
+struct RESET_RECORD_STRUCT
+{
+	uint8_t		cause,				// MCUSR of last reset: WDRF, BORF, EXTRF, PORF
+				wdt_resets,			// Watchdog resets, saturates at 0xFF
+				overruns;			// Deadline misses before those resets, saturates at 0xFF
+};
+
+/************************************************************************/
+/* FUNCTIONS                                                            */
+/************************************************************************/
+#if (RTOS_WDT_ENABLE)
+extern	struct	RESET_RECORD_STRUCT		reset_record;
+extern	void reset_Init(void);											// Account last reset, call before RTOS_Init
+#endif
+
+#endif
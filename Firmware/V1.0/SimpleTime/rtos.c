@@ -7,8 +7,11 @@
 #include "config.h"
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <avr/wdt.h>
 #include <util/atomic.h>
 #include "rtos.h"
+#include "trace.h"
 
 /************************************************************************/
 /* VARS                                                                 */
@@ -19,64 +22,222 @@ volatile static    struct  RTOS_TimerTaskQueue							// Timer structure
     TPTR        RunTask;
     uint16_t    Time;
 } RTOS_TimerTaskQueue[RTOS_TIMER_TASK_QUEUE_SIZE+1];
+#if (RTOS_DROPS_ENABLE)
+volatile uint8_t   RTOS_TaskDrops;											// Task queue full, saturates
+volatile uint8_t   RTOS_TimerDrops;										// Timer queue full, saturates
+#endif
+
+#if (RTOS_WDT_ENABLE)
+volatile static    uint16_t RTOS_DeadlineLeft[RTOS_DEADLINES_COUNT];		// Systicks to next deadline, 0 - missed or unused
+volatile static    uint8_t RTOS_DeadlineMissed;							// Latched, watchdog is not fed anymore
+uint8_t RTOS_Overruns __attribute__((section(".noinit")));					// Not cleared by startup code
+#endif
+
+#if (RTOS_LOAD_ENABLE)
+static    uint8_t  RTOS_LoadStamp;										// Systick counter at last pass entry
+static    uint8_t  RTOS_LoadIdlePass;									// Last pass found no task
+static    uint16_t RTOS_LoadIdle;										// Idle counter ticks, wraps
+#endif
+
+#if (RTOS_PROFILE_ENABLE)
+volatile static    uint8_t RTOS_ProfileTicks;								// Systick counter, wraps
+volatile static    uint8_t RTOS_TaskQueueStamp[RTOS_TASK_QUEUE_SIZE];		// Systick when task was queued
+struct  RTOS_PROFILE_STRUCT    RTOS_Profile[RTOS_PROFILE_SLOTS];				// Per task stats
+uint8_t RTOS_ProfileIsr[RTOS_PROFILE_ISR_COUNT];								// Max ISR duration
+#endif
 
 
 /************************************************************************/
 /* RTOS Initialization                                                  */
 /************************************************************************/
-inline void RTOS_Init(void)
+void RTOS_Init(void)
 {
     uint8_t i=0;
 
     // Initialization RTOS task queue
     for(i=0; i < RTOS_TASK_QUEUE_SIZE; i++)
     {
-        RTOS_TaskQueue[i] = Idle;
+        RTOS_TaskQueue[i] = RTOS_NO_TASK;
     }
 
     // Initialization RTOS timer task queue
     for(i=0; i < RTOS_TIMER_TASK_QUEUE_SIZE; i++)
     {
-        RTOS_TimerTaskQueue[i].RunTask = Idle;
+        RTOS_TimerTaskQueue[i].RunTask = RTOS_NO_TASK;
         RTOS_TimerTaskQueue[i].Time = 0;
     }
+
+#if (RTOS_WDT_ENABLE)
+    // Arm all deadlines, tasks are started right after
+    for(i=0; i < RTOS_DEADLINES_COUNT; i++)
+    {
+        RTOS_DeadlineLeft[i] = pgm_read_word(&RTOS_Deadlines[i].budget);
+    }
+    wdt_enable(RTOS_WDT_TIMEOUT);
+#endif
+}
+
+#if (RTOS_WDT_ENABLE)
+/************************************************************************/
+/* RTOS Deadline restart on task dispatch, interrupts are disabled      */
+/************************************************************************/
+static void RTOS_DeadlineRestart(TPTR task)
+{
+    uint8_t     i;
+
+    for(i=0; i < RTOS_DEADLINES_COUNT; i++) {
+        if((TPTR)pgm_read_ptr(&RTOS_Deadlines[i].task) == task) {
+            RTOS_DeadlineLeft[i] = pgm_read_word(&RTOS_Deadlines[i].budget);
+            return;
+        }
+    }
+}
+#endif
+
+/************************************************************************/
+/* IDLE function, weak so application or host simulator can replace it  */
+/************************************************************************/
+void __attribute__((weak)) Idle(void)
+{
+}
+
+#if (RTOS_LOAD_ENABLE)
+/************************************************************************/
+/* RTOS Load: time since last pass entry is idle if that pass was idle  */
+/************************************************************************/
+static void RTOS_LoadAccount(void)
+{
+    uint8_t     counter = SYSTICK_TIMER_COUNTER;
+
+    // Idle pass is far shorter than a systick, counter wraps once at most
+    if(RTOS_LoadIdlePass) {
+        RTOS_LoadIdle += (counter >= RTOS_LoadStamp) ? counter - RTOS_LoadStamp : counter + (SYSTICK_OCR_CONST + 1) - RTOS_LoadStamp;
+    }
+    RTOS_LoadStamp = counter;
 }
 
 /************************************************************************/
-/* IDLE function                                                        */
+/* RTOS Load: idle counter ticks since last call                        */
 /************************************************************************/
-inline void Idle(void)
+uint16_t RTOS_IdleTake(void)
 {
+    uint16_t    idle = RTOS_LoadIdle;
+
+    RTOS_LoadIdle = 0;
+    return idle;
 }
+#endif
 
+#if (RTOS_PROFILE_ENABLE)
 /************************************************************************/
-/* RTOS Setup task into queue                                           */
+/* RTOS Profiling time stamp: systick count << 8 | counter              */
 /************************************************************************/
-void RTOS_SetTask(TPTR TS)
+static uint16_t RTOS_ProfileNow(void)
+{
+    uint8_t     ticks = RTOS_ProfileTicks;
+    uint8_t     counter = SYSTICK_TIMER_COUNTER;
+
+    // Counter was cleared by compare match, ISR is held off by caller
+    if(SYSTICK_PENDING) {
+        ticks++;
+        counter = SYSTICK_TIMER_COUNTER;
+    }
+    return (uint16_t)ticks << 8 | counter;
+}
+
+/************************************************************************/
+/* RTOS Profiling counter ticks between two stamps, saturates at 255    */
+/************************************************************************/
+static uint8_t RTOS_ProfileSpan(uint16_t from, uint16_t to)
+{
+    uint8_t     ticks = (to >> 8) - (from >> 8);
+    int16_t     span = (int16_t)(uint8_t)to - (uint8_t)from;
+
+    // No hardware multiplier, whole systicks are added one by one
+    while(ticks--) {
+        span += SYSTICK_OCR_CONST + 1;
+        if(span > 255) return 255;
+    }
+    return span;
+}
+
+/************************************************************************/
+/* RTOS Profiling store ISR duration, start is counter at ISR entry     */
+/************************************************************************/
+void RTOS_ProfileIsrEnd(uint8_t isr, uint8_t start)
+{
+    uint8_t     counter = SYSTICK_TIMER_COUNTER;
+    uint8_t     span = (counter >= start) ? counter - start : counter + (SYSTICK_OCR_CONST + 1) - start;
+
+    if(span > RTOS_ProfileIsr[isr]) RTOS_ProfileIsr[isr] = span;
+}
+
+/************************************************************************/
+/* RTOS Profiling account one task run                                  */
+/************************************************************************/
+static void RTOS_ProfileTask(TPTR task, uint8_t queued, uint16_t start)
+{
+    uint8_t     i;
+    uint8_t     late = (uint8_t)(start >> 8) - queued;
+    uint8_t     run = RTOS_ProfileSpan(start, RTOS_ProfileNow());
+    struct RTOS_PROFILE_STRUCT *p = RTOS_Profile;
+
+    // Find task slot or take first free one
+    for(i=0; i < RTOS_PROFILE_SLOTS; i++, p++) {
+        if(p->task == task) break;
+        if(p->task == RTOS_NO_TASK) {
+            p->task = task;
+            p->run_avg = (uint16_t)run << 3;
+            break;
+        }
+    }
+    // All slots are taken by other tasks
+    if(i == RTOS_PROFILE_SLOTS) return;
+
+    if(run > p->run_max) p->run_max = run;
+    if(late > p->late_max) p->late_max = late;
+    p->run_avg += run - (p->run_avg >> 3);
+}
+#endif
+
+/************************************************************************/
+/* RTOS Setup task into queue, 1 - queued or already waiting, 0 - full  */
+/************************************************************************/
+uint8_t RTOS_SetTask(TPTR TS)
 {
     uint8_t     i=0;
     // Disable interrupts while processing queue
     // if interrupt was enabled
 	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
 		// Checking queue free
-		while(RTOS_TaskQueue[i] != Idle)
+		while(RTOS_TaskQueue[i] != RTOS_NO_TASK)
 		{
+			// Task is waiting already, one run serves both requests
+			if(RTOS_TaskQueue[i] == TS)
+				return 1;
 			i++;
-			// If no free space - return
-			if (i == RTOS_TASK_QUEUE_SIZE)
-				return;
+			// If no free space - count and report drop
+			if (i == RTOS_TASK_QUEUE_SIZE) {
+#if (RTOS_DROPS_ENABLE)
+				if(RTOS_TaskDrops != 0xFF) RTOS_TaskDrops++;
+#endif
+				return 0;
+			}
 		}
 
 		// Adding task into queue
 		RTOS_TaskQueue[i] = TS;
+#if (RTOS_PROFILE_ENABLE)
+		RTOS_TaskQueueStamp[i] = RTOS_ProfileTicks;
+#endif
 	}
-
+	return 1;
 }
 
 /************************************************************************/
-/* RTOS Setup task into timer queue                                     */
+/* RTOS Setup task into timer queue, 1 - set, 0 - queue is full         */
 /************************************************************************/
-void RTOS_SetTimerTask(TPTR TS, uint16_t NewTime)
+uint8_t RTOS_SetTimerTask(TPTR TS, uint16_t NewTime)
 {
     uint8_t     i=0;
 
@@ -89,31 +250,47 @@ void RTOS_SetTimerTask(TPTR TS, uint16_t NewTime)
 			if(RTOS_TimerTaskQueue[i].RunTask == TS) {
 				// Set new time for run
 				RTOS_TimerTaskQueue[i].Time = NewTime;
-				return;
+				return 1;
 			}
 		}
 
 		// Setup task into queue if not exists in queue
 		for(i=0; i < RTOS_TIMER_TASK_QUEUE_SIZE; i++) {
 			// Search free space in task queue
-			if (RTOS_TimerTaskQueue[i].RunTask == Idle) {
+			if (RTOS_TimerTaskQueue[i].RunTask == RTOS_NO_TASK) {
 				// Set task
 				RTOS_TimerTaskQueue[i].RunTask = TS;
 				RTOS_TimerTaskQueue[i].Time = NewTime;
-				return;
+				return 1;
 			}
 		}
+		// No free space in queue - count and report drop
+#if (RTOS_DROPS_ENABLE)
+		if(RTOS_TimerDrops != 0xFF) RTOS_TimerDrops++;
+#endif
 	}
-    // IF NO FREE SPACE IN QUEUE - IGNORE TASK!!!
+	return 0;
 }
 
 /************************************************************************/
 /* RTOS Task Manager                                                    */
 /************************************************************************/
-inline void RTOS_TaskManager(void)
+void RTOS_TaskManager(void)
 {
     uint8_t	    i=0;
-    TPTR	    RunTask=Idle;
+    TPTR	    RunTask=RTOS_NO_TASK;
+#if (RTOS_PROFILE_ENABLE)
+    uint8_t     queued;
+    uint16_t    start;
+#endif
+
+#if (RTOS_LOAD_ENABLE)
+    RTOS_LoadAccount();
+#endif
+#if (RTOS_WDT_ENABLE)
+    // Scheduler is alive, feed watchdog while all deadlines hold
+    if(!RTOS_DeadlineMissed) wdt_reset();
+#endif
 
     // Disable interrupts
     //RTOS_INTERRUPT_DISABLE();
@@ -122,50 +299,90 @@ inline void RTOS_TaskManager(void)
     // Get first task from queue
     RunTask = RTOS_TaskQueue[0];
 
-    // If task is IDLE - run IDLE function
-    if (RunTask == Idle) {
+    // If queue is empty - run IDLE function
+    if (RunTask == RTOS_NO_TASK) {
         //RTOS_INTERRUPT_ENABLE();
 		sei();
+#if (RTOS_LOAD_ENABLE)
+        RTOS_LoadIdlePass = 1;
+#endif
+        // Trace bytes go out only when nothing else is to be done
+        TRACE_DRAIN();
         (Idle)();
 
         // If task is other function - run function
     } else {
+#if (RTOS_PROFILE_ENABLE)
+        queued = RTOS_TaskQueueStamp[0];
+#endif
         // Shift pointers in queue
         for(i=0; i < RTOS_TASK_QUEUE_SIZE-1; i++) {
 			RTOS_TaskQueue[i] = RTOS_TaskQueue[i+1];
+#if (RTOS_PROFILE_ENABLE)
+			RTOS_TaskQueueStamp[i] = RTOS_TaskQueueStamp[i+1];
+#endif
         }
 
-        // Setup IDLE function into last cell of queue
-        RTOS_TaskQueue[RTOS_TASK_QUEUE_SIZE-1] = Idle;
+        // Mark last cell of queue as free
+        RTOS_TaskQueue[RTOS_TASK_QUEUE_SIZE-1] = RTOS_NO_TASK;
 
+#if (RTOS_WDT_ENABLE)
+        RTOS_DeadlineRestart(RunTask);
+#endif
+#if (RTOS_LOAD_ENABLE)
+        RTOS_LoadIdlePass = 0;
+#endif
+#if (RTOS_PROFILE_ENABLE)
+        start = RTOS_ProfileNow();
+#endif
+        TRACE_PUT(TRACE_EVENT_TASK, TRACE_TASK_ID(RunTask));
         // Enable interrupts
         //RTOS_INTERRUPT_ENABLE();
 		sei();
         (RunTask)();
+#if (RTOS_PROFILE_ENABLE)
+        cli();
+        RTOS_ProfileTask(RunTask, queued, start);
+        sei();
+#endif
     }
 }
 
 /************************************************************************/
 /* RTOS Timer service                                                   */
 /************************************************************************/
-inline void RTOS_TimerService(void)
+void RTOS_TimerService(void)
 {
     uint8_t     i;
 
+#if (RTOS_PROFILE_ENABLE)
+    RTOS_ProfileTicks++;
+#endif
+#if (RTOS_WDT_ENABLE)
+    // Count down deadlines, a miss is counted once and latched
+    for(i=0; i < RTOS_DEADLINES_COUNT; i++) {
+        if(RTOS_DeadlineLeft[i] && !--RTOS_DeadlineLeft[i]) {
+            RTOS_DeadlineMissed = 1;
+            if(RTOS_Overruns != 0xFF) RTOS_Overruns++;
+        }
+    }
+#endif
     // Processing TASK queue
     for(i=0; i < RTOS_TIMER_TASK_QUEUE_SIZE; i++) {
-        // If current task is IDLE - continue
-        if(RTOS_TimerTaskQueue[i].RunTask == Idle) continue;
+        // If current cell is free - continue
+        if(RTOS_TimerTaskQueue[i].RunTask == RTOS_NO_TASK) continue;
 
-        // If current task is not IDLE
+        // If current cell holds a task
         if(RTOS_TimerTaskQueue[i].Time > 0) {
             // If time not left - decrement
             RTOS_TimerTaskQueue[i].Time--;
-        } else {
-            // Else - set task for run
-            RTOS_SetTask(RTOS_TimerTaskQueue[i].RunTask);
+        } else if(RTOS_SetTask(RTOS_TimerTaskQueue[i].RunTask)) {
+            // Else - task is set for run
+            TRACE_PUT(TRACE_EVENT_TIMER, TRACE_TASK_ID(RTOS_TimerTaskQueue[i].RunTask));
             // Remove task from timer queue
-            RTOS_TimerTaskQueue[i].RunTask = Idle;
+            RTOS_TimerTaskQueue[i].RunTask = RTOS_NO_TASK;
         }
+        // Task queue is full - keep expired task here and retry on next
+        // systick, a self re-arming loop is delayed but never lost
     }
 }
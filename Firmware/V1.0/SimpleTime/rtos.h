@@ -12,7 +12,110 @@ extern  void    RTOS_Init(void);
 
 typedef void    (*TPTR)(void);
 
-extern  void    RTOS_SetTask(TPTR TS);
-extern  void    RTOS_SetTimerTask(TPTR TS, uint16_t NewTime);
+// Free queue cell marker. Compares against zero are cheaper than against
+// the Idle address and the queues in .bss start out empty after reset
+#define RTOS_NO_TASK    ((TPTR)0)
+
+// Both return 1 when the task is queued, 0 when the queue is full and
+// the request is dropped. A task that is queued already is not added
+// twice: run queue keeps its place, timer queue takes the new time
+extern  uint8_t RTOS_SetTask(TPTR TS);
+extern  uint8_t RTOS_SetTimerTask(TPTR TS, uint16_t NewTime);
 extern  void    RTOS_TaskManager(void);
 extern  void    RTOS_TimerService(void);
+
+#if (RTOS_DROPS_ENABLE)
+extern  volatile uint8_t RTOS_TaskDrops;		// Run queue full, includes retried timer tasks
+extern  volatile uint8_t RTOS_TimerDrops;		// Timer queue full, task is lost
+#endif
+
+/************************************************************************/
+/* PROTOTHREADS                                                         */
+/************************************************************************/
+// Stackless coroutines on plain TPTR tasks. A task keeps its resume line
+// in one RTOS_PT variable and queues itself again while it waits. Locals
+// do not survive a wait, keep loop counters in statics, and no switch of
+// the task itself may enclose a wait. RTOS_SetTask wakes a waiting task
+// early, waits which must not be cut short use RTOS_PT_WAIT_UNTIL.
+// A wait that finds the timer queue full goes through the run queue, if
+// that is full too the task resumes on its next RTOS_SetTask, so code
+// which hands work to a task queues it every time
+typedef uint16_t RTOS_PT;				// Resume line, 0 - task not started
+
+#define RTOS_PT_ARM						0x8000	// Resume line bit, wait is not armed yet
+
+#if (__GNUC__ >= 7)
+	#define RTOS_PT_FALLTHROUGH				__attribute__((fallthrough))
+#else
+	#define RTOS_PT_FALLTHROUGH
+#endif
+
+#define RTOS_PT_BEGIN(pt)					switch(pt) { case 0:
+#define RTOS_PT_END(pt)						} (pt) = 0
+
+// Resume after at least ms milliseconds, ms is taken again when arming is retried
+#define RTOS_PT_WAIT_MS(pt, task, ms)		do { (pt) = __LINE__ | RTOS_PT_ARM; RTOS_PT_FALLTHROUGH; case __LINE__ | RTOS_PT_ARM: \
+												if(RTOS_SetTimerTask(task, ms)) (pt) = __LINE__; else RTOS_SetTask(task); \
+												return; case __LINE__:; } while(0)
+// Resume once cond holds, it is checked every systick meanwhile
+#define RTOS_PT_WAIT_UNTIL(pt, task, cond)	do { (pt) = __LINE__; RTOS_PT_FALLTHROUGH; case __LINE__: \
+												if(!(cond)) { if(!RTOS_SetTimerTask(task, 0)) RTOS_SetTask(task); return; } } while(0)
+
+/************************************************************************/
+/* SUPERVISION                                                          */
+/************************************************************************/
+// Application defines RTOS_Deadlines[] in flash. Every periodic task
+// must be dispatched again within its budget, otherwise the scheduler
+// stops feeding the watchdog and the MCU resets with relay off
+#if (RTOS_WDT_ENABLE)
+struct RTOS_DEADLINE_STRUCT
+{
+	TPTR		task;				// Periodic task
+	uint16_t	budget;				// Max systicks between two dispatches
+};
+
+extern  const   struct  RTOS_DEADLINE_STRUCT   RTOS_Deadlines[RTOS_DEADLINES_COUNT];
+extern  uint8_t RTOS_Overruns;		// Deadline misses, survives watchdog reset
+#endif
+
+/************************************************************************/
+/* LOAD                                                                 */
+/************************************************************************/
+// Scheduler passes which found no task are timed entry to entry in
+// systick counter ticks (8us), ISRs hitting such a pass count as idle
+#if (RTOS_LOAD_ENABLE)
+extern  uint16_t RTOS_IdleTake(void);			// Idle counter ticks since last call, wraps
+#endif
+
+/************************************************************************/
+/* PROFILING                                                            */
+/************************************************************************/
+// Times are taken from the systick timer: runtime and ISR duration in
+// counter ticks (8us), start lateness in systicks (1ms), all saturate at 255
+#if (RTOS_PROFILE_ENABLE)
+enum RTOS_PROFILE_ISR_ENUM
+{
+	RTOS_PROFILE_ISR_SYSTICK,		// TIMER0_COMPA_vect
+	RTOS_PROFILE_ISR_TICK,			// TIMER1_COMPA_vect
+	RTOS_PROFILE_ISR_COUNT
+};
+
+struct RTOS_PROFILE_STRUCT
+{
+	TPTR		task;				// Profiled task, RTOS_NO_TASK if slot is free
+	uint8_t		run_max,			// Longest run
+				late_max;			// Longest wait in queue before start
+	uint16_t	run_avg;			// Running average of runtime << 3
+};
+
+extern  struct  RTOS_PROFILE_STRUCT    RTOS_Profile[RTOS_PROFILE_SLOTS];
+extern  uint8_t RTOS_ProfileIsr[RTOS_PROFILE_ISR_COUNT];
+extern  void    RTOS_ProfileIsrEnd(uint8_t isr, uint8_t start);
+
+// First and last statements of a profiled ISR body
+#define RTOS_PROFILE_ISR_BEGIN()		uint8_t rtos_isr_start = SYSTICK_TIMER_COUNTER
+#define RTOS_PROFILE_ISR_END(isr)		RTOS_ProfileIsrEnd(isr, rtos_isr_start)
+#else
+#define RTOS_PROFILE_ISR_BEGIN()
+#define RTOS_PROFILE_ISR_END(isr)
+#endif
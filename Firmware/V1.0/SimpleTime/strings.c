@@ -0,0 +1,72 @@
+/*
+ * strings.c
+ *
+ * Created: 19.10.2026 10:12:40
+ *  UI strings catalog in flash
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <avr/pgmspace.h>
+
+#include "strings.h"
+
+/************************************************************************/
+/* VARS                                                                 */
+/************************************************************************/
+static const	char	str_title[]		PROGMEM = " Timer:";
+#if (STOPWATCH_ENABLE)
+static const	char	str_stopwatch[]	PROGMEM = " Stopwatch";
+#endif
+#if (SCHED_ENABLE)
+static const	char	str_sched[]		PROGMEM = " Day clock";
+static const	char	str_weekdays[]	PROGMEM = "MoTuWeThFrSaSu";
+#endif
+#if (DIAG_ENABLE)
+static const	char	str_diag_stack[] PROGMEM = "Stack free/total";
+static const	char	str_diag_queue[] PROGMEM = "Queue full r/tmr";
+#if (RTOS_PROFILE_ENABLE)
+static const	char	str_diag_isr[]	PROGMEM = "ISR T0/T1 8us";
+static const	char	str_diag_task[]	PROGMEM = "Task run avg lat";
+#endif
+#if (RTOS_WDT_ENABLE)
+static const	char	str_diag_reset[] PROGMEM = "Rst cause/wdt/ov";
+#endif
+#if (DIAG_BENCH_ENABLE)
+static const	char	str_diag_lcd[]	PROGMEM = "LCD bytes/s";
+static const	char	str_diag_jitter[] PROGMEM = "Systick lat 8us";
+static const	char	str_diag_tick[]	PROGMEM = "Tick err ppm";
+static const	char	str_diag_idle[]	PROGMEM = "Sched idle";
+static const	char	str_diag_encoder[] PROGMEM = "Enc bad steps";
+#endif
+#endif
+
+//-> Catalog indexed by ST_STRING_ID_ENUM
+const char * const		st_strings[STR_COUNT] PROGMEM = {
+	[STR_TITLE]			= str_title,
+#if (STOPWATCH_ENABLE)
+	[STR_STOPWATCH]		= str_stopwatch,
+#endif
+#if (SCHED_ENABLE)
+	[STR_SCHED]			= str_sched,
+	[STR_WEEKDAYS]		= str_weekdays,
+#endif
+#if (DIAG_ENABLE)
+	[STR_DIAG_STACK]	= str_diag_stack,
+	[STR_DIAG_QUEUE]	= str_diag_queue,
+#if (RTOS_PROFILE_ENABLE)
+	[STR_DIAG_ISR]		= str_diag_isr,
+	[STR_DIAG_TASK]		= str_diag_task,
+#endif
+#if (RTOS_WDT_ENABLE)
+	[STR_DIAG_RESET]	= str_diag_reset,
+#endif
+#if (DIAG_BENCH_ENABLE)
+	[STR_DIAG_LCD]		= str_diag_lcd,
+	[STR_DIAG_JITTER]	= str_diag_jitter,
+	[STR_DIAG_TICK]		= str_diag_tick,
+	[STR_DIAG_IDLE]		= str_diag_idle,
+	[STR_DIAG_ENCODER]	= str_diag_encoder,
+#endif
+#endif
+};
@@ -7,8 +7,51 @@
 #ifndef ST_STRINGS_H
 #define ST_STRINGS_H
 
+#include "config.h"
+
 #include <stdio.h>
 #include <avr/pgmspace.h>
 
+/************************************************************************/
+/* STRING CATALOG                                                       */
+/************************************************************************/
+// All UI text lives in flash and is addressed by ID. Rendering goes
+// through hd44780_PutsF(ST_STR(id)), string literals must not be passed
+// to hd44780_Puts because they are copied into .data at startup.
+enum ST_STRING_ID_ENUM
+{
+	STR_TITLE,					// Countdown screen title
+#if (STOPWATCH_ENABLE)
+	STR_STOPWATCH,				// Stopwatch screen title
+#endif
+#if (SCHED_ENABLE)
+	STR_SCHED,					// Time of day clock screen title
+	STR_WEEKDAYS,				// Two letters per weekday from Monday
+#endif
+#if (DIAG_ENABLE)
+	STR_DIAG_STACK,				// Diagnostics: stack free/total
+	STR_DIAG_QUEUE,				// Diagnostics: RTOS queue drops
+#if (RTOS_PROFILE_ENABLE)
+	STR_DIAG_ISR,				// Diagnostics: ISR max duration
+	STR_DIAG_TASK,				// Diagnostics: task runtime and lateness
+#endif
+#if (RTOS_WDT_ENABLE)
+	STR_DIAG_RESET,				// Diagnostics: reset cause and counters
+#endif
+#if (DIAG_BENCH_ENABLE)
+	STR_DIAG_LCD,				// Benchmark: LCD bus throughput
+	STR_DIAG_JITTER,			// Benchmark: systick ISR entry latency
+	STR_DIAG_TICK,				// Benchmark: 1 Hz tick error
+	STR_DIAG_IDLE,				// Benchmark: scheduler idle share
+	STR_DIAG_ENCODER,			// Benchmark: invalid encoder transitions
+#endif
+#endif
+	STR_COUNT
+};
+
+extern	const char * const	st_strings[STR_COUNT] PROGMEM;
+
+// Get flash address of catalog string by ID
+#define ST_STR(id)						((const char *)pgm_read_ptr(&st_strings[id]))
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,110 @@
+/*
+ * trace.c
+ *
+ * Created: 19.10.2026 14:20:33
+ *  Event trace output on PD6
+ */
+#include "config.h"
+
+#include <stdio.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#include "trace.h"
+
+#if (TRACE_ENABLE)
+/************************************************************************/
+/* VARS                                                                 */
+/************************************************************************/
+static	volatile	uint8_t		trace_buffer[TRACE_BUFFER_SIZE];		// Ring buffer
+static	volatile	uint8_t		trace_head,								// Next byte to write
+								trace_count,							// Bytes waiting
+								trace_lost;								// Records dropped since last LOST record
+
+#define TRACE_RECORD_SIZE				3
+// Timer clocks needed to send one byte
+#define TRACE_SYSTICK_CLOCKS			(TRACE_BYTE_CYCLES / SYSTICK_PRESCALER + 1)
+#define TRACE_TICK_CLOCKS				(TRACE_BYTE_CYCLES / TIMER_TICK_PRESCALER + 1)
+
+
+/************************************************************************/
+/* FUNCTIONS                                                            */
+/************************************************************************/
+//------------------------------ Store one record, buffer has room for it
+static void trace_Store(uint8_t event, uint8_t arg)
+{
+	uint8_t i = trace_head;
+
+	trace_buffer[i] = 0x80 | event;
+	i = (i + 1) & (TRACE_BUFFER_SIZE - 1);
+	trace_buffer[i] = arg;
+	i = (i + 1) & (TRACE_BUFFER_SIZE - 1);
+	trace_buffer[i] = SYSTICK_TIMER_COUNTER;
+	trace_head = (i + 1) & (TRACE_BUFFER_SIZE - 1);
+	trace_count += TRACE_RECORD_SIZE;
+}
+
+//------------------------------ Queue record, safe in ISR
+void trace_Put(uint8_t event, uint8_t arg)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		// Report drops first, when there is room for both records
+		if(trace_lost && trace_count <= TRACE_BUFFER_SIZE - 2 * TRACE_RECORD_SIZE) {
+			trace_Store(TRACE_EVENT_LOST, trace_lost);
+			trace_lost = 0;
+		}
+		if(trace_lost || trace_count > TRACE_BUFFER_SIZE - TRACE_RECORD_SIZE) {
+			if(trace_lost != 0xFF) trace_lost++;
+		} else {
+			trace_Store(event, arg);
+		}
+	}
+}
+
+//------------------------------ Send one byte 8N2, interrupts must be disabled
+static void trace_TxByte(uint8_t data)
+{
+	// Start bit 0, data, two stop bits so next start is never early
+	uint16_t frame = (uint16_t)data << 1 | 0x600;
+	uint8_t bits = 11, delay;
+
+	// Both branches of bit output take 5 cycles, bit period is 10 + 3 * TRACE_BIT_DELAY
+	__asm volatile (
+		"1:	sbrs	%A[frame], 0		\n\t"
+		"	cbi		%[port], %[pin]		\n\t"
+		"	sbrc	%A[frame], 0		\n\t"
+		"	sbi		%[port], %[pin]		\n\t"
+		"	lsr		%B[frame]			\n\t"
+		"	ror		%A[frame]			\n\t"
+		"	ldi		%[delay], %[count]	\n\t"
+		"2:	dec		%[delay]			\n\t"
+		"	brne	2b					\n\t"
+		"	dec		%[bits]				\n\t"
+		"	brne	1b					\n\t"
+		: [frame] "+r" (frame), [bits] "+r" (bits), [delay] "=&d" (delay)
+		: [port] "I" (_SFR_IO_ADDR(TRACE_PORT)), [pin] "I" (TRACE_BIT), [count] "M" (TRACE_BIT_DELAY)
+	);
+}
+
+//------------------------------ Send one byte if no timer compare is due while sending
+void trace_Drain(void)
+{
+	uint8_t data;
+
+	if(!trace_count) return;
+
+	cli();
+	// Pending ISR must run first, next compare must be far enough
+	if((TIFR & (1<<OCF0A|1<<OCF1A))
+		|| SYSTICK_TIMER_OCR - SYSTICK_TIMER_COUNTER <= TRACE_SYSTICK_CLOCKS
+		|| (TIMER_TICK_CHECK && TIMER_TICK_OCR_REG - TIMER_TICK_COUNTER_REG <= TRACE_TICK_CLOCKS)) {
+		sei();
+		return;
+	}
+	data = trace_buffer[(trace_head - trace_count) & (TRACE_BUFFER_SIZE - 1)];
+	trace_count--;
+	trace_TxByte(data);
+	sei();
+}
+#endif
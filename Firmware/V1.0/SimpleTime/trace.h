@@ -0,0 +1,49 @@
+/*
+ * trace.h
+ *
+ * Created: 19.10.2026 14:20:41
+ *  Event trace output on PD6
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+
+// Record is three bytes: 0x80 | event, argument, SYSTICK counter.
+// Milliseconds are counted by the decoder from systick ISR entries.
+enum TRACE_EVENT_ENUM
+{
+	TRACE_EVENT_ISR_ENTER,		// Argument is TRACE_ISR_ENUM
+	TRACE_EVENT_ISR_EXIT,		// Argument is TRACE_ISR_ENUM
+	TRACE_EVENT_TIMER,			// Timer task expired, argument is task ID
+	TRACE_EVENT_TASK,			// Task dispatched, argument is task ID
+	TRACE_EVENT_RELAY,			// Channel output, argument is channel << 1 | new state
+	TRACE_EVENT_EEPROM,			// EEPROM write, argument is byte count
+	TRACE_EVENT_LOST,			// Records dropped on full buffer, argument is count
+	TRACE_EVENTS_COUNT
+};
+
+enum TRACE_ISR_ENUM
+{
+	TRACE_ISR_SYSTICK,			// TIMER0_COMPA_vect
+	TRACE_ISR_TICK				// TIMER1_COMPA_vect
+};
+
+// Task ID is low byte of task word address, as in function pointers
+#define TRACE_TASK_ID(task)				((uint8_t)(uintptr_t)(task))
+
+/************************************************************************/
+/* FUNCTIONS                                                            */
+/************************************************************************/
+#if (TRACE_ENABLE)
+extern	void trace_Put(uint8_t event, uint8_t arg);						// Queue record, safe in ISR
+extern	void trace_Drain(void);											// Send one byte if timers allow
+
+#define TRACE_PUT(event, arg)			trace_Put(event, arg)
+#define TRACE_DRAIN()					trace_Drain()
+#else
+#define TRACE_PUT(event, arg)
+#define TRACE_DRAIN()
+#endif
+
+#endif
@@ -42,7 +42,7 @@ char * utoa_cycle_sub(uint8_t value, char *buffer)
 	uint8_t i = 0;
 	do
 	{
-		uint8_t pow3 = pgm_read_dword(pow3Table8 + (i++));
+		uint8_t pow3 = pgm_read_byte(pow3Table8 + (i++));
 		uint8_t count = 0;
 		while(value >= pow3)
 		{
@@ -56,3 +56,18 @@ char * utoa_cycle_sub(uint8_t value, char *buffer)
 	while(buffer[j] == '0') ++buffer;
 	return buffer;
 }
+
+char * utoa_two_digits(uint8_t value, char *buffer)
+{
+	// Values 0..99 only, printed with leading zero without division
+	uint8_t tens = '0';
+	while(value >= 10)
+	{
+		tens++;
+		value -= 10;
+	}
+	buffer[0] = tens;
+	buffer[1] = value + '0';
+	buffer[2] = 0;
+	return buffer;
+}
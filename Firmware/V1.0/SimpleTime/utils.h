@@ -12,6 +12,7 @@
 
 extern	char * hex_to_ascii(uint8_t number, char * buffer);
 extern	char * utoa_cycle_sub(uint8_t value, char *buffer);
+extern	char * utoa_two_digits(uint8_t value, char *buffer);
 
 
 